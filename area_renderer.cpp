@@ -0,0 +1,156 @@
+/*
+ * area_renderer.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <cstring>
+
+#include "area_renderer.h"
+
+namespace DiamondCA {
+
+#define SPEC_WIDTH 4
+
+static void appendUnsigned(std::string& out, unsigned int value) {
+	char digits[10];
+	int n = 0;
+	do {
+		digits[n++] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+	while (n > 0) out += digits[--n];
+}
+
+AreaRenderer::AreaRenderer(const int3& sizes, ThreadPool* pool) :
+		_sizes(sizes), _pool(pool), _layers(sizes.z), _line_offsets(sizes.z) { }
+
+void AreaRenderer::forLayers(const PoolTask& task) {
+	if (_pool) {
+		_pool->run(_sizes.z, task);
+	} else {
+		for (int z = 0; z < _sizes.z; ++z) task(z);
+	}
+}
+
+template <class TypeOf>
+void AreaRenderer::renderTypes(const TypeOf& type_of) {
+	forLayers([this, &type_of](unsigned int z) {
+		std::string& layer = _layers[z];
+		layer.clear();
+
+		// координаты слоя одинаковы во всех его строках
+		std::string z_suffix(" ");
+		appendUnsigned(z_suffix, z);
+		z_suffix += '\n';
+
+		unsigned int site = z * _sizes.y * _sizes.x;
+		for (int iy = 0; iy < _sizes.y; ++iy) {
+			for (int ix = 0; ix < _sizes.x; ++ix, ++site) {
+				int type = type_of(site);
+				if (type == 0) continue;
+
+				appendUnsigned(layer, type);
+				layer += ' ';
+				appendUnsigned(layer, ix);
+				layer += ' ';
+				appendUnsigned(layer, iy);
+				layer += z_suffix;
+			}
+		}
+	});
+
+	_result.clear();
+	for (int z = 0; z < _sizes.z; ++z) _result += _layers[z];
+	_result += "0 0 0 0";
+}
+
+const std::string& AreaRenderer::types(const Cell* cells) {
+	renderTypes([cells](unsigned int site) { return cells[site].empty() ? 0 : cells[site].type(); });
+	return _result;
+}
+
+const std::string& AreaRenderer::types(const unsigned char* types) {
+	renderTypes([types](unsigned int site) { return (int)types[site]; });
+	return _result;
+}
+
+void AreaRenderer::renderSpecsLayer(const Cell* cells, int z) {
+	std::string& layer = _layers[z];
+	std::vector<unsigned int>& offsets = _line_offsets[z];
+	layer.clear();
+	offsets.resize(_sizes.y + 1);
+
+	unsigned int site = z * _sizes.y * _sizes.x;
+	for (int iy = 0; iy < _sizes.y; ++iy) {
+		offsets[iy] = layer.size();
+		if (z > 0) layer += "  | ";
+
+		for (int ix = 0; ix < _sizes.x; ++ix, ++site) {
+			const char* spec = cells[site].empty() ? "." : cells[site].spec();
+			// выравнивание по правому краю поля, как при width() потока
+			int spec_length = strlen(spec);
+			if (spec_length < SPEC_WIDTH) layer.append(SPEC_WIDTH - spec_length, ' ');
+			layer.append(spec, spec_length);
+		}
+	}
+	offsets[_sizes.y] = layer.size();
+}
+
+const std::string& AreaRenderer::specs(const Cell* cells) {
+	forLayers([this, cells](unsigned int z) { renderSpecsLayer(cells, z); });
+
+	_result.clear();
+	for (int iy = 0; iy < _sizes.y; ++iy) {
+		for (int z = 0; z < _sizes.z; ++z) {
+			const std::vector<unsigned int>& offsets = _line_offsets[z];
+			_result.append(_layers[z], offsets[iy], offsets[iy + 1] - offsets[iy]);
+		}
+		_result += '\n';
+	}
+	return _result;
+}
+
+const std::string& AreaRenderer::types(const SiteId* sites, const Cell* cells, unsigned int sites_num) {
+	unsigned int layer_size = _sizes.y * _sizes.x;
+
+	_result.clear();
+	for (unsigned int i = 0; i < sites_num; ++i) {
+		unsigned int xy = sites[i] % layer_size;
+		appendUnsigned(_result, cells[i].type());
+		_result += ' ';
+		appendUnsigned(_result, xy % _sizes.x);
+		_result += ' ';
+		appendUnsigned(_result, xy / _sizes.x);
+		_result += ' ';
+		appendUnsigned(_result, sites[i] / layer_size);
+		_result += '\n';
+	}
+	_result += "0 0 0 0";
+	return _result;
+}
+
+const std::string& AreaRenderer::heightMap(const SiteId* sites, unsigned int sites_num) {
+	unsigned int layer_size = _sizes.y * _sizes.x;
+	_heights.assign(layer_size, -1);
+	for (unsigned int i = 0; i < sites_num; ++i) {
+		int z = sites[i] / layer_size;
+		int& height = _heights[sites[i] % layer_size];
+		if (z > height) height = z;
+	}
+
+	_result.clear();
+	unsigned int column = 0;
+	for (int iy = 0; iy < _sizes.y; ++iy) {
+		for (int ix = 0; ix < _sizes.x; ++ix, ++column) {
+			if (ix > 0) _result += ' ';
+			if (_heights[column] < 0) _result += "-1";
+			else appendUnsigned(_result, _heights[column]);
+		}
+		_result += '\n';
+	}
+	return _result;
+}
+
+}
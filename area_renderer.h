@@ -0,0 +1,66 @@
+/*
+ * area_renderer.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef AREA_RENDERER_H_
+#define AREA_RENDERER_H_
+
+#include <string>
+#include <vector>
+
+#include "int3.h"
+#include "cell.h"
+#include "lattice.h"
+#include "thread_pool.h"
+
+namespace DiamondCA {
+
+// Текстовый вид решётки для выходных файлов. Каждый слой по Z форматируется в свой буфер
+// (слои - параллельно, если задан пул потоков), затем буферы склеиваются по порядку.
+// Буферы переиспользуются между вызовами, числа и виды узлов пишутся без потоков ввода-вывода.
+class AreaRenderer {
+public:
+	AreaRenderer(const int3& sizes, ThreadPool* pool = 0);
+	virtual ~AreaRenderer() { }
+
+	// строки "тип x y z" для занятых узлов и завершающая строка "0 0 0 0" (файл .wxyz);
+	// types - типы узлов по номерам, 0 - пустой узел
+	const std::string& types(const Cell* cells);
+	const std::string& types(const unsigned char* types);
+
+	// то же только для перечисленных узлов (по возрастанию номеров) с их состояниями
+	const std::string& types(const SiteId* sites, const Cell* cells, unsigned int sites_num);
+
+	// виды узлов: строка на каждый Y, в которой подряд идут слои по Z
+	const std::string& specs(const Cell* cells);
+
+	// карта высот: строка на каждый Y из наибольших Z занятых узлов столбцов по X (-1 - пустой столбец);
+	// sites должны содержать верхний узел каждого столбца, например поверхностную оболочку
+	const std::string& heightMap(const SiteId* sites, unsigned int sites_num);
+
+private:
+	AreaRenderer();
+
+	template <class TypeOf>
+	void renderTypes(const TypeOf& type_of);
+	void renderSpecsLayer(const Cell* cells, int z);
+
+	void forLayers(const PoolTask& task);
+
+private:
+	int3 _sizes;
+	ThreadPool* _pool;
+
+	std::vector<std::string> _layers;
+	// начала строк по Y в буфере слоя при выводе видов
+	std::vector< std::vector<unsigned int> > _line_offsets;
+	std::string _result;
+	std::vector<int> _heights;
+};
+
+}
+
+#endif /* AREA_RENDERER_H_ */
@@ -0,0 +1,60 @@
+/*
+ * async_writer.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "async_writer.h"
+
+namespace DiamondCA {
+
+AsyncWriter::AsyncWriter(unsigned int capacity) :
+		_capacity(capacity), _pending_num(0), _stop(false), _thread(&AsyncWriter::work, this) { }
+
+AsyncWriter::~AsyncWriter() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_posted.notify_one();
+	_thread.join();
+}
+
+void AsyncWriter::waitForRoom() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_pending_num >= _capacity) _done.wait(lock);
+}
+
+void AsyncWriter::post(const WriteJob& job) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(job);
+		++_pending_num;
+	}
+	_posted.notify_one();
+}
+
+void AsyncWriter::flush() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_pending_num > 0) _done.wait(lock);
+}
+
+void AsyncWriter::work() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (true) {
+		while (_jobs.empty() && !_stop) _posted.wait(lock);
+		if (_jobs.empty()) break;
+
+		WriteJob job = _jobs.front();
+		_jobs.pop_front();
+		lock.unlock();
+		job();
+		lock.lock();
+
+		--_pending_num;
+		_done.notify_all();
+	}
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ * async_writer.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef ASYNC_WRITER_H_
+#define ASYNC_WRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace DiamondCA {
+
+typedef std::function<void ()> WriteJob;
+
+// Фоновый поток вывода с ограниченной очередью заданий. Заданием считается и то, что уже
+// выполняется, поэтому при ёмкости n выполняется или ждёт не больше n заданий; если поток
+// вывода отстаёт, waitForRoom() задерживает расчёт, пока задание не освободит место.
+class AsyncWriter {
+public:
+	AsyncWriter(unsigned int capacity);
+	// выполняет все оставшиеся задания
+	virtual ~AsyncWriter();
+
+	unsigned int capacity() const { return _capacity; }
+
+	void waitForRoom();
+	// вызывающий должен сначала дождаться места в очереди
+	void post(const WriteJob& job);
+	// ждёт выполнения всех заданий
+	void flush();
+
+private:
+	AsyncWriter();
+	AsyncWriter(const AsyncWriter&);
+	AsyncWriter& operator=(const AsyncWriter&);
+
+	void work();
+
+private:
+	unsigned int _capacity;
+	std::deque<WriteJob> _jobs;
+	// задания в очереди и выполняемое
+	unsigned int _pending_num;
+	bool _stop;
+
+	std::mutex _mutex;
+	std::condition_variable _posted;
+	std::condition_variable _done;
+
+	std::thread _thread;
+};
+
+}
+
+#endif /* ASYNC_WRITER_H_ */
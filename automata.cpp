@@ -6,45 +6,64 @@
  */
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <cstdlib>
 #include <ctime>
+#include <iostream>
+#include <set>
 #include <sstream>
 #include <vector>
-//#include <iostream>
 
+#include "area_renderer.h"
 #include "automata.h"
+#include "checkpoint_error.h"
+#include "kinetic_engine.h"
 #include "outputer.h"
 
 namespace DiamondCA {
 
-typedef std::vector<Cell*> VariantCells;
-typedef std::vector<int3> VariantCoords;
+// любой процесс затрагивает узлы не дальше трёх ячеек по X и Y от обрабатываемого узла
+#define DOMAIN_MIN_SIZE 8
+
+// слои, лежащие ниже самого верхнего занятого на столько слоёв, считаются погребёнными:
+// процессы идут не глубже двух слоёв под узлом поверхности
+#define BURIED_LAYERS_NUM 4
+
+thread_local Automata::Domain* Automata::_deferred_domain = 0;
+
+// удаление элемента без сохранения порядка
+static void removeAt(VariantSites& sites, unsigned int index) {
+	sites[index] = sites.back();
+	sites.pop_back();
+}
 
 Automata::Automata(const Handbook& handbook, const FlagsConfig& config, Outputer& outputer) :
-		_config(config), _outputer(&outputer),
-		_hydrogen_atoms_num(0),
+		_features(0), _handbook(&handbook), _outputer(&outputer),
+		_sizes(handbook.sizes()), _lattice(_sizes), _stencil(_sizes),
+		_is_shell_tracked(false),
+		_is_morphology_tracked(false), _heights_sum(0), _heights_squares_sum(0), _layers_carbons(0),
+		_changes(_sizes), _epoch(1),
+		_checkerboard(_sizes, DOMAIN_MIN_SIZE), _pool(0),
+		_domains(_checkerboard.tilesNum()),
+		_touched_sites(0),
 		_active_dimers_num(0),
-		_active_bonds_num(0),
 //		_active_bridges_num(0),
 		_bridges_num(0),
 		_abstracted_hydrogen_atoms_num(0), _adsorbed_hydrogen_atoms_num(0), _adsorbed_methyl_radicals_num(0),
 		_migrated_hydrogen_atoms_num(0), _migrated_bridges_num(0)
 {
-	_outputer->setAutomata(this);
-
-	_sizes = handbook.sizes();
-
-	_cells = new Cell***[_sizes.z];
-	for (int iz = 0; iz < _sizes.z; ++iz) {
-		_cells[iz] = new Cell**[_sizes.y];
-		for (int iy = 0; iy < _sizes.y; ++iy) {
-			_cells[iz][iy] = new Cell*[_sizes.x];
-			for (int ix = 0; ix < _sizes.x; ++ix) {
-				_cells[iz][iy][ix] = 0;
-			}
-		}
+	static const char* feature_names[FEATURES_NUM] = {
+		"dimers-form-drop", "hydrogen-migration", "activate-surface", "deactivate-surface",
+		"methyl-adsorption", "bridge-migration", "bridge-migration-up-down", "kinetic"
+	};
+	for (int f = 0; f < FEATURES_NUM; ++f) {
+		if (flagOf(config, feature_names[f])) _features |= 1u << f;
 	}
 
+	_outputer->setAutomata(this);
+	seed(time(0));
+
 	stickToCells("", Range(0, 0));
 
 	_dt = handbook.dt();
@@ -56,16 +75,21 @@ Automata::Automata(const Handbook& handbook, const FlagsConfig& config, Outputer
 }
 
 Automata::~Automata() {
-	for (int iz = 0; iz < _sizes.z; ++iz) {
-		for (int iy = 0; iy < _sizes.y; ++iy) {
-			for (int ix = 0; ix < _sizes.x; ++ix) {
-				if (_cells[iz][iy][ix]) delete _cells[iz][iy][ix];
-			}
-			delete[] _cells[iz][iy];
-		}
-		delete[] _cells[iz];
+	delete _pool;
+	delete[] _layers_carbons;
+}
+
+void Automata::seed(uint64_t seed) {
+	for (int p = 0; p < PROCESSES_NUM; ++p) _random[p] = Random(seed, p);
+	// потоки доменов следуют за общими потоками процессов
+	for (unsigned int t = 0; t < _domains.size(); ++t) {
+		for (int p = 0; p < PROCESSES_NUM; ++p) _domains[t].random[p] = Random(seed, p + PROCESSES_NUM * (t + 1));
 	}
-	delete[] _cells;
+}
+
+void Automata::setThreads(unsigned int threads_num) {
+	delete _pool;
+	_pool = (threads_num > 1) ? new ThreadPool(threads_num) : 0;
 }
 
 void Automata::stickToCells(const char* mix, const Range& z_range) {
@@ -84,56 +108,148 @@ void Automata::stickToCells(const char* mix, const Range& z_range, const Range&
 	for (int iz = z_range.first; iz <= z_range.second; ++iz) {
 		for (int iy = y_range.first; iy <= y_range.second; ++iy) {
 			for (int ix = x_range.first; ix <= x_range.second; ++ix) {
-				if (_cells[iz][iy][ix]) _cells[iz][iy][ix]->compose(mix);
-				else _cells[iz][iy][ix] = new Cell(mix, iz, iy, ix);
+				SiteId site = _lattice.site(int3(iz, iy, ix));
+				Cell old_cell = _lattice[site];
+				_lattice[site].compose(mix);
+				changed(site, old_cell);
 			}
 		}
 	}
 }
 
+void Automata::stickInitialCells(const char* initial_spec) {
+	stickToCells(initial_spec, Range(1, 1));
+	stickToCells("*", Range(1, 1), Range(1, 2), Range(1, 2));
+	stickToCells("*", Range(2, 2), Range(1, 2), Range(1, 1));
+	stickToCells("*H", Range(3, 3), Range(2, 2), Range(1, 1));
+	stickToCells("*", Range(1, 1), Range(4, 5), Range(4, 5));
+	stickToCells("*", Range(2, 2), Range(4, 5), Range(4, 4));
+	stickToCells("*H", Range(3, 3), Range(5, 5), Range(4, 4));
+	stickToCells("*", Range(1, 1), Range(7, 8), Range(7, 8));
+	stickToCells("*", Range(2, 2), Range(7, 8), Range(7, 7));
+	stickToCells("*H", Range(3, 3), Range(8, 8), Range(7, 7));
+}
+
 std::string Automata::typesArea() const {
-	std::stringstream area;
-	for (int iz = 0; iz < _sizes.z; ++iz) {
-		for (int iy = 0; iy < _sizes.y; ++iy) {
-			for (int ix = 0; ix < _sizes.x; ++ix) {
-				if (!_cells[iz][iy][ix]) continue;
-				area << _cells[iz][iy][ix]->type() << ' ' << ix << ' ' << iy << ' ' << iz << '\n';
-			}
-		}
+	AreaRenderer renderer(_sizes);
+	return renderer.types(_lattice.cells());
+}
+
+void Automata::areaTypes(AreaTypes& types) const {
+	areaTypes(_lattice.volume(), _lattice.cells(), types);
+}
+
+void Automata::areaTypes(unsigned int volume, const Cell* cells, AreaTypes& types) {
+	types.resize(volume);
+	for (SiteId site = 0; site < volume; ++site) {
+		types[site] = cells[site].empty() ? 0 : cells[site].type();
 	}
-	area << "0 0 0 0";
+}
 
-	return area.str();
+void Automata::trackSurfaceShell() {
+	if (_is_shell_tracked) return;
+
+	_is_shell_tracked = true;
+	for (SiteId site = 0; site < _lattice.volume(); ++site) updateShell(site);
 }
 
-std::string Automata::specsArea() const {
-	std::stringstream* lines = new std::stringstream[_sizes.y];
-	std::string spec;
-	for (int iz = 0; iz < _sizes.z; ++iz) {
-		for (int iy = 0; iy < _sizes.y; ++iy) {
-			if (iz > 0) lines[iy] << "  | ";
-
-			for (int ix = 0; ix < _sizes.x; ++ix) {
-				if (_cells[iz][iy][ix]) spec = _cells[iz][iy][ix]->spec();
-				else spec = ".";
-
-				lines[iy].width(4);
-				lines[iy] << spec;
-			}
+void Automata::trackMorphology() {
+	if (_is_morphology_tracked) return;
+
+	_is_morphology_tracked = true;
+	_column_heights.resize(_sizes.y * _sizes.x);
+	_heights_nums.resize(_sizes.z);
+	_layers_carbons = new std::atomic<int>[_sizes.z];
+	recountMorphology();
+}
+
+void Automata::recountMorphology() {
+	unsigned int layer_size = _sizes.y * _sizes.x;
+	_column_heights.assign(layer_size, 0);
+	for (int z = 0; z < _sizes.z; ++z) {
+		int carbons_num = 0;
+		for (unsigned int column = 0; column < layer_size; ++column) {
+			if (_lattice[z * layer_size + column].empty()) continue;
+			++carbons_num;
+			_column_heights[column] = z;
 		}
+		_layers_carbons[z].store(carbons_num, std::memory_order_relaxed);
+	}
+
+	_heights_nums.assign(_sizes.z, 0);
+	_heights_sum = 0;
+	_heights_squares_sum = 0;
+	for (unsigned int column = 0; column < layer_size; ++column) {
+		int height = _column_heights[column];
+		++_heights_nums[height];
+		_heights_sum += height;
+		_heights_squares_sum += (long long)height * height;
+	}
+}
+
+void Automata::updateColumnHeight(SiteId site) {
+	unsigned int layer_size = _sizes.y * _sizes.x;
+	unsigned int column = site % layer_size;
+	int z = site / layer_size;
+	int height = _column_heights[column];
+
+	if (!_lattice[site].empty()) {
+		if (z > height) setColumnHeight(column, z);
+	} else if (z == height) {
+		// верхний узел столбца исчез: вершина - ближайший занятый узел ниже
+		while (height > 0 && _lattice[height * layer_size + column].empty()) --height;
+		setColumnHeight(column, height);
 	}
+}
+
+void Automata::setColumnHeight(unsigned int column, int height) {
+	int old_height = _column_heights[column];
+	--_heights_nums[old_height];
+	++_heights_nums[height];
+	_heights_sum += height - old_height;
+	_heights_squares_sum += (long long)height * height - (long long)old_height * old_height;
+	_column_heights[column] = height;
+}
+
+void Automata::morphology(std::vector<int>& heights_nums, std::vector<int>& layers_carbons) const {
+	int max_z = _population.max_z;
+	heights_nums.assign(_heights_nums.begin(), _heights_nums.begin() + max_z + 1);
+	layers_carbons.resize(max_z + 1);
+	for (int z = 0; z <= max_z; ++z) layers_carbons[z] = _layers_carbons[z].load(std::memory_order_relaxed);
+}
+
+void Automata::surfaceShell(VariantSites& sites, std::vector<Cell>& cells) const {
+	sites.assign(_shell.members(), _shell.members() + _shell.size());
+	std::sort(sites.begin(), sites.end());
+
+	cells.resize(sites.size());
+	for (unsigned int i = 0; i < sites.size(); ++i) cells[i] = _lattice[sites[i]];
+}
+
+bool Automata::isShell(SiteId site) const {
+	const Cell& cell = _lattice[site];
+	if (cell.empty()) return false;
+	if (cell.active() + cell.hydro() > 0) return true;
 
-	std::stringstream area;
-	for (int iy = 0; iy < _sizes.y; ++iy) {
-		area << lines[iy].str() << '\n';
+	int3 above_coords[2];
+	_stencil.above(_lattice.coords(site), above_coords);
+	for (int i = 0; i < 2; ++i) {
+		if (getSite(above_coords[i]) == Lattice::NO_SITE) return true;
 	}
+	return false;
+}
 
-	delete[] lines;
+void Automata::updateShell(SiteId site) {
+	if (isShell(site)) _shell.insert(site);
+	else _shell.erase(site);
+}
 
-	return area.str();
+std::string Automata::specsArea() const {
+	AreaRenderer renderer(_sizes);
+	return renderer.specs(_lattice.cells());
 }
 
-std::string Automata::infoHead() const {
+std::string Automata::infoHead(bool with_morphology) {
 	std::stringstream info;
 	info << "Time (sec)"
 			<< "\tMax Z"
@@ -148,20 +264,22 @@ std::string Automata::infoHead() const {
 			<< "\tAdsorbed hydrogen atoms"
 			<< "\tAdsorbed methyl radicals"
 			<< "\tMigrated hydrogen atoms"
-			<< "\tMigrated bridges"
-			<< '\n';
+			<< "\tMigrated bridges";
+	for (int t = 1; t <= Cell::TYPES_NUM; ++t) info << "\tCells of type " << t;
+	if (with_morphology) info << "\tMean height\tRoughness";
+	info << '\n';
 	return info.str();
 }
 
 std::string Automata::infoBody() const {
 	std::stringstream info;
 	info << _time
-			<< '\t' << _max_z
-			<< '\t' << _carbons_num
-			<< '\t' << _hydrogen_atoms_num
+			<< '\t' << _population.max_z
+			<< '\t' << _population.carbons_num
+			<< '\t' << _population.hydrogen_atoms_num
 			<< '\t' << _dimer_bonds.size()
 			<< '\t' << _active_dimers_num
-			<< '\t' << _active_bonds_num
+			<< '\t' << _population.active_bonds_num
 //			<< '\t' << _active_bridges_num
 			<< '\t' << _bridges_num
 			<< '\t' << _abstracted_hydrogen_atoms_num
@@ -169,618 +287,1086 @@ std::string Automata::infoBody() const {
 			<< '\t' << _adsorbed_methyl_radicals_num
 			<< '\t' << _migrated_hydrogen_atoms_num
 			<< '\t' << _migrated_bridges_num;
+	for (int t = 0; t < Cell::TYPES_NUM; ++t) info << '\t' << _population.types_num[t];
+	if (_is_morphology_tracked) {
+		// шероховатость - среднеквадратичное отклонение высот столбцов от средней
+		double columns_num = _column_heights.size();
+		double mean = _heights_sum / columns_num;
+		double variance = _heights_squares_sum / columns_num - mean * mean;
+		info << '\t' << mean << '\t' << ((variance > 0) ? sqrt(variance) : 0);
+	}
 	return info.str();
 }
 
-void Automata::exploreArea() {
-	_max_z = 1;
-	_carbons_num = 0;
+void Automata::recountSurface() {
+	_bridges_num = _bridges.size();
 
-	for (int iz = 0; iz < _sizes.z; ++iz) {
-		for (int iy = 0; iy < _sizes.y; ++iy) {
-			for (int ix = 0; ix < _sizes.x; ++ix) {
-				if (!_cells[iz][iy][ix]) continue;
+	_active_dimers_num = activeDimersNum();
+}
 
-				++_carbons_num;
-				if (iz > _max_z) _max_z = iz;
-				if (_cells[iz][iy][ix]->active() > 0) {
-					_actives.insert(_cells[iz][iy][ix]);
-					_active_bonds_num += _cells[iz][iy][ix]->active();
-				}
-				if (_cells[iz][iy][ix]->hydro() > 0) {
-					_hydrides.insert(_cells[iz][iy][ix]);
-					_hydrogen_atoms_num += _cells[iz][iy][ix]->hydro();
-				}
-			}
-		}
+void Automata::run(float full_time, float out_any_time) {
+	if (enabled(WITH_KINETIC)) {
+		KineticEngine engine(*this);
+		engine.run(full_time, out_any_time);
+	} else {
+		runSteps(full_time, out_any_time);
 	}
+
+	PROFILE_REPORT(_profiler);
 }
 
-void Automata::run(float full_time, float out_any_time) {
+void Automata::runSteps(float full_time, float out_any_time) {
 	unsigned int steps = (unsigned int)(full_time / _dt + 0.5);
 	unsigned int out_any_step = 1;
 	if (out_any_time > 0) out_any_step = (unsigned int)(out_any_time / _dt + 0.5);
 
-	exploreArea();
+	unsigned int percent_step = (unsigned int)(steps * 0.001);
+	if (percent_step == 0) percent_step = 1;
+
+	for (unsigned int step_index = _progress.step; step_index <= steps; ++step_index) {
+		if (step_index % percent_step == 0) _outputer->outputPercent((float)(100 * step_index) / steps);
+		if (step_index % out_any_step == 0) {
+			_time = step_index * _dt;
+			outputStep();
+		}
 
-	typedef void (Automata::*StepFunc)();
-	typedef std::vector<StepFunc> StepFuncs;
+		step();
 
-	StepFuncs step_funcs;
-	if (_config["hydrogen-migration"]) step_funcs.push_back(&Automata::migratingHydrogen);
-	if (_config["activate-surface"]) step_funcs.push_back(&Automata::activatingSurface);
-	if (_config["deactivate-surface"]) step_funcs.push_back(&Automata::deactivatingSurface);
-	if (_config["methyl-adsorption"]) step_funcs.push_back(&Automata::addingBridges);
-	if (_config["bridge-migration"]) step_funcs.push_back(&Automata::migratingBridges);
-	if (_config["dimers-form-drop"]) {
-		step_funcs.push_back(&Automata::formingDimers);
-		step_funcs.push_back(&Automata::droppingDimers);
+		_progress.step = step_index + 1;
+		if (checkpointIfRequested()) return;
 	}
+}
 
-	unsigned int percent_step = (unsigned int)(steps * 0.001);
-	if (percent_step == 0) percent_step = 1;
+void Automata::outputStep() {
+	archiveBuriedLayers();
+
+	{
+		PROFILE_SCOPE(_profiler, OUTPUT, 0);
+		_outputer->outputStep();
+	}
+	PROFILE_OUTPUT_DONE(_profiler);
+}
 
-	srand(time(0));
+void Automata::archiveBuriedLayers() {
+	int buried_z = _population.max_z - BURIED_LAYERS_NUM;
+	if (buried_z > 0) _lattice.archive(_lattice.site(int3(buried_z, 0, 0)), Cell(""));
+}
 
-	unsigned int step = 0;
-	for ( ; step <= steps; ++step) {
-		if (step % percent_step == 0) _outputer->outputPercent((float)(100 * step) / steps);
-		if (step % out_any_step == 0) {
-			_time = step * _dt;
-			_outputer->outputStep();
+void Automata::step() {
+	if (enabled(WITH_HYDROGEN_MIGRATION)) {
+		nextEpoch();
+		PROFILE_SCOPE(_profiler, HYDROGEN_MIGRATION, _dimers[MIGRATING_DIMER].size());
+		migratingHydrogen();
+		PROFILE_EVENTS(_migrated_hydrogen_atoms_num);
+	}
+	if (enabled(WITH_SURFACE_ACTIVATION)) {
+		nextEpoch();
+		PROFILE_SCOPE(_profiler, SURFACE_ACTIVATION, _population.hydrogen_atoms_num);
+		activatingSurface();
+		PROFILE_EVENTS(_abstracted_hydrogen_atoms_num);
+	}
+	if (enabled(WITH_SURFACE_DEACTIVATION)) {
+		nextEpoch();
+		PROFILE_SCOPE(_profiler, SURFACE_DEACTIVATION, _population.active_bonds_num);
+		deactivatingSurface();
+		PROFILE_EVENTS(_adsorbed_hydrogen_atoms_num);
+	}
+	if (enabled(WITH_METHYL_ADSORPTION)) {
+		nextEpoch();
+		PROFILE_SCOPE(_profiler, METHYL_ADSORPTION, activeDimersNum());
+		addingBridges();
+		PROFILE_EVENTS(_adsorbed_methyl_radicals_num);
+	}
+	if (enabled(WITH_BRIDGE_MIGRATION)) {
+		nextEpoch();
+		PROFILE_SCOPE(_profiler, BRIDGE_MIGRATION, _bridges.size());
+		migratingBridges();
+		PROFILE_EVENTS(_migrated_bridges_num);
+	}
+	if (enabled(WITH_DIMERS_FORM_DROP)) {
+		// образованные и разорванные димеры отдельно не считаются: их число - изменение числа связей
+		{
+			nextEpoch();
+			PROFILE_SCOPE_FROM(_profiler, DIMERS_FORMING, _formable_pairs.size(), _dimer_bonds.size());
+			formingDimers();
+			PROFILE_EVENTS(_dimer_bonds.size() - PROFILE_BASE);
 		}
+		{
+			nextEpoch();
+			PROFILE_SCOPE_FROM(_profiler, DIMERS_DROPPING, _dimer_bonds.size(), _dimer_bonds.size());
+			droppingDimers();
+			PROFILE_EVENTS(PROFILE_BASE - _dimer_bonds.size());
+		}
+	}
+}
+
+void Automata::setProfile(const std::string& file_name, unsigned int write_every) {
+	_profiler.setReport(file_name, write_every);
+}
+
+void Automata::setEpoch(uint64_t epoch) {
+	_epoch = (epoch > 0) ? epoch : 1;
+	_changes.clear();
+	for (unsigned int i = 0; i < _bridges_destinations.size(); ++i) _bridges_destinations[i].epoch = 0;
+}
+
+void Automata::nextEpoch() {
+	// иначе старые метки карты изменений оказались бы больше новых эпох
+	if (++_epoch == 0) setEpoch(1);
+}
 
-		for (StepFuncs::const_iterator it = step_funcs.begin(); it != step_funcs.end(); ++it) {
-			(this->*(*it))();
+void Automata::setCheckpoint(const std::string& file_name, unsigned int period_secs) {
+	_checkpoint_file_name = file_name;
+	_checkpoint_schedule.start(period_secs);
+}
+
+bool Automata::checkpointIfRequested() {
+	if (_checkpoint_file_name.empty()) return false;
+
+	CheckpointSchedule::Request request = _checkpoint_schedule.poll();
+	if (request != CheckpointSchedule::NO_REQUEST) {
+		// неудачный снимок не прерывает расчёт, предыдущий снимок остаётся
+		try {
+			saveCheckpoint();
+		} catch(const CheckpointError& e) {
+			std::cerr << e.getMessage() << std::endl;
 		}
 	}
+	return request == CheckpointSchedule::SAVE_AND_STOP;
 }
 
-void Automata::formingDimers() {
-	SetOfCells* actives_not_dimers = differentCells(_actives, _dimers);
-	for (SetOfCells::iterator it = actives_not_dimers->begin(); it != actives_not_dimers->end(); ++it) {
-		Cell* current_cell = *it;
+// Снимок: заголовок (метка, версия, размеры, включённые процессы, шаг по времени), место продолжения
+// расчёта, счётчики, состояния генераторов, состояния узлов решётки и множества узлов в их порядке -
+// от порядка зависит выбор случайных элементов, поэтому множества не перестраиваются по решётке.
+// Кэш назначений мостовых групп не сохраняется: после загрузки он пересчитывается.
+static const char CHECKPOINT_MAGIC[8] = { 'D', 'C', 'A', 'C', 'K', 'P', 'T', '\0' };
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+void Automata::saveCheckpoint() {
+	CheckpointWriter writer(_checkpoint_file_name);
+
+	writer.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+	writer.write(CHECKPOINT_VERSION);
+	writer.write(_sizes);
+	writer.write(_features);
+	writer.write(_dt);
+
+	writer.write(_progress);
+	writer.write(_time);
+	writer.write(_population);
+	int counters[] = { _active_dimers_num, _bridges_num, _abstracted_hydrogen_atoms_num,
+			_adsorbed_hydrogen_atoms_num, _adsorbed_methyl_radicals_num, _migrated_hydrogen_atoms_num,
+			_migrated_bridges_num };
+	writer.write(counters);
+
+	uint32_t state[8];
+	for (int p = 0; p < PROCESSES_NUM; ++p) {
+		_random[p].state(state);
+		writer.write(state);
+	}
+	for (unsigned int t = 0; t < _domains.size(); ++t) {
+		for (int p = 0; p < PROCESSES_NUM; ++p) {
+			_domains[t].random[p].state(state);
+			writer.write(state);
+		}
+	}
 
-//		if (actives_not_dimers->count(current_cell) == 0) continue;
-		if (_dimers.count(current_cell) > 0) continue;
+	writer.write(_lattice.cells(), _lattice.volume() * sizeof(Cell));
 
-		VariantCells may_be_dimer;
+	const IndexedSet* sets[] = { &_dimer_bonds, &_dimers[MIGRATING_DIMER], &_dimers[ACTIVE_DIMER],
+			&_dimers[HYDRO_DIMER], &_actives, &_hydrides, &_formable_pairs, &_bridges };
+	for (unsigned int i = 0; i < sizeof(sets) / sizeof(sets[0]); ++i) {
+		uint32_t size = sets[i]->size();
+		writer.write(size);
+		writer.write(sets[i]->members(), size * sizeof(SiteId));
+	}
 
-		int3 direct_n_coords[2];
-		directNeighboursCoords(current_cell->coords(), direct_n_coords);
-		for (int i = 0; i < 2; ++i) {
-			Cell* direct_n_cell = _cells[direct_n_coords[i].z][direct_n_coords[i].y][direct_n_coords[i].x];
-			if (!direct_n_cell || direct_n_cell->active() == 0 || _dimers.count(direct_n_cell) > 0) continue;
+	writer.commit();
+}
 
-			int3 top_n_coords;
-			topNeighbourCoords(current_cell->coords(), direct_n_cell->coords(), top_n_coords);
-			Cell* top_n_cell = _cells[top_n_coords.z][top_n_coords.y][top_n_coords.x];
-			if (top_n_cell) continue;
+void Automata::restore(const std::string& file_name) {
+	CheckpointReader reader(file_name);
+
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	reader.read(magic, sizeof(magic));
+	if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || reader.read<uint32_t>() != CHECKPOINT_VERSION) {
+		throw CheckpointError("File " + file_name + " is not a checkpoint of this program version");
+	}
+	int3 sizes = reader.read<int3>();
+	if (sizes.x != _sizes.x || sizes.y != _sizes.y || sizes.z != _sizes.z) {
+		throw CheckpointError("Checkpoint " + file_name + " was saved for other automata sizes");
+	}
+	if (reader.read<unsigned int>() != _features || reader.read<float>() != _dt) {
+		throw CheckpointError("Checkpoint " + file_name + " was saved with other processes or time step");
+	}
 
-			may_be_dimer.push_back(direct_n_cell);
+	_progress = reader.read<Progress>();
+	_time = reader.read<float>();
+	_population = reader.read<Population>();
+	int counters[7];
+	reader.read(counters, sizeof(counters));
+	_active_dimers_num = counters[0];
+	_bridges_num = counters[1];
+	_abstracted_hydrogen_atoms_num = counters[2];
+	_adsorbed_hydrogen_atoms_num = counters[3];
+	_adsorbed_methyl_radicals_num = counters[4];
+	_migrated_hydrogen_atoms_num = counters[5];
+	_migrated_bridges_num = counters[6];
+
+	uint32_t state[8];
+	for (int p = 0; p < PROCESSES_NUM; ++p) {
+		reader.read(state, sizeof(state));
+		_random[p].restore(state);
+	}
+	for (unsigned int t = 0; t < _domains.size(); ++t) {
+		for (int p = 0; p < PROCESSES_NUM; ++p) {
+			reader.read(state, sizeof(state));
+			_domains[t].random[p].restore(state);
 		}
+	}
 
-		if (may_be_dimer.empty()) continue;
+	_lattice.assign((const Cell*)reader.read(_lattice.volume() * sizeof(Cell)));
+
+	IndexedSet* sets[] = { &_dimer_bonds, &_dimers[MIGRATING_DIMER], &_dimers[ACTIVE_DIMER],
+			&_dimers[HYDRO_DIMER], &_actives, &_hydrides, &_formable_pairs, &_bridges };
+	for (unsigned int i = 0; i < sizeof(sets) / sizeof(sets[0]); ++i) {
+		uint32_t size = reader.read<uint32_t>();
+		const SiteId* members = (const SiteId*)reader.read(size * sizeof(SiteId));
+		sets[i]->clear();
+		for (uint32_t m = 0; m < size; ++m) {
+			SiteId site;
+			memcpy(&site, members + m, sizeof(SiteId));
+			sets[i]->insert(site);
+		}
+	}
+	_bridges_destinations.assign(_bridges.size(), CachedDestinations());
+	if (_is_shell_tracked) {
+		_shell.clear();
+		for (SiteId site = 0; site < _lattice.volume(); ++site) updateShell(site);
+	}
+	if (_is_morphology_tracked) recountMorphology();
 
-		unsigned int random_index = rand() % may_be_dimer.size();
-		Cell* random_direct_n_cell = may_be_dimer[random_index];
+	if (!reader.atEnd()) throw CheckpointError("Checkpoint " + file_name + " has unexpected data at the end");
+}
 
-		_dimer_bonds[current_cell] = random_direct_n_cell;
+void Automata::formingDimers() {
+	// оба конца каждой пары, способной образовать димер; узел может входить в две пары,
+	// но при повторном обходе он уже в димере и пропускается
+	VariantSites actives_not_dimers;
+	actives_not_dimers.reserve(2 * _formable_pairs.size());
+	for (unsigned int i = 0; i < _formable_pairs.size(); ++i) {
+		SiteId site = _formable_pairs[i];
+		int3 direct_n_coords[2];
+		directNeighboursCoords(_lattice.coords(site), direct_n_coords);
+		actives_not_dimers.push_back(site);
+		actives_not_dimers.push_back(_lattice.site(direct_n_coords[1]));
+	}
 
-		formDimerPart(current_cell);
-		formDimerPart(random_direct_n_cell);
+	if (byDomains()) {
+		clearDomains();
+		for (unsigned int i = 0; i < actives_not_dimers.size(); ++i) {
+			_domains[domainOf(actives_not_dimers[i])].sites.push_back(actives_not_dimers[i]);
+		}
+		// партнёр может лежать в соседней плитке, поэтому по цветам
+		inDomains(&Automata::formingDimersIn, true);
+		return;
+	}
 
-//		actives_not_dimers->erase(si);
-//		actives_not_dimers->erase(random_direct_n_cell);
+	for (VariantSites::const_iterator it = actives_not_dimers.begin(); it != actives_not_dimers.end(); ++it) {
+		formDimerRandomly(*it, _random[DIMERS_FORMING]);
 	}
+}
 
-	delete actives_not_dimers;
+void Automata::formingDimersIn(Domain& domain) {
+	for (unsigned int i = 0; i < domain.sites.size(); ++i) {
+		formDimerRandomly(domain.sites[i], domain.random[DIMERS_FORMING]);
+	}
 }
 
-void Automata::droppingDimers() {
-	VariantCells dimer_cells1(_dimer_bonds.size());
-	VariantCells dimer_cells2(_dimer_bonds.size());
+void Automata::formDimerRandomly(SiteId current_site, Random& random) {
+	if (_lattice[current_site].isDimer()) return;
 
-	int i = 0;
-	for (CellToCell::const_iterator it = _dimer_bonds.begin(); it != _dimer_bonds.end(); ++it) {
-		dimer_cells1[i] = it->first;
-		dimer_cells2[i] = it->second;
-		++i;
+	int may_be_dimer[2];
+	int partners_num = 0;
+	for (int i = 0; i < 2; ++i) {
+		if (isDimerFormable(current_site, i)) may_be_dimer[partners_num++] = i;
 	}
 
-	int dropped_dimers_num = (int)(_dimer_bonds.size() * _percent_of_not_dimers + 0.5);
-	for (i = 0; i < dropped_dimers_num; ++i) {
-		unsigned int random_index = rand() % dimer_cells1.size();
+	if (partners_num == 0) return;
 
-		VariantCells::iterator dcit1 = dimer_cells1.begin() + random_index;
-		VariantCells::iterator dcit2 = dimer_cells2.begin() + random_index;
+	unsigned int random_index = random.bounded(partners_num);
+	formDimer(current_site, may_be_dimer[random_index]);
+}
 
-		activate(*dcit1);
-		activate(*dcit2);
+void Automata::droppingDimers() {
+	int dropped_dimers_num = (int)(_dimer_bonds.size() * _percent_of_not_dimers + 0.5);
+	if (byDomains()) {
+		clearDomains();
+		for (unsigned int i = 0; i < _dimer_bonds.size(); ++i) {
+			_domains[domainOf(_dimer_bonds[i])].sites.push_back(_dimer_bonds[i]);
+		}
+		shareEvents(dropped_dimers_num, true, _random[DIMERS_DROPPING]);
+		inDomains(&Automata::droppingDimersIn, false);
+		return;
+	}
 
-		deleteDimer(*dcit1, *dcit2);
+	// разорванный димер сам покидает _dimer_bonds
+	for (int i = 0; i < dropped_dimers_num && !_dimer_bonds.empty(); ++i) {
+		SiteId dimer_site = _dimer_bonds[_random[DIMERS_DROPPING].bounded(_dimer_bonds.size())];
+		dropDimer(dimer_site, partnerSite(dimer_site));
+	}
+}
+
+void Automata::droppingDimersIn(Domain& domain) {
+	Random& random = domain.random[DIMERS_DROPPING];
+	VariantSites& dimer_sites = domain.sites;
 
-		dimer_cells1.erase(dcit1);
-		dimer_cells2.erase(dcit2);
+	for (int i = 0; i < domain.events_num && !dimer_sites.empty(); ++i) {
+		unsigned int random_index = random.bounded(dimer_sites.size());
+		SiteId dimer_site = dimer_sites[random_index];
+		dropDimer(dimer_site, partnerSite(dimer_site));
+		removeAt(dimer_sites, random_index);
 	}
 }
 
 void Automata::migratingHydrogen() {
-	VariantCells dimer_cells1, dimer_cells2;
-	for (CellToCell::const_iterator it = _dimer_bonds.begin(); it != _dimer_bonds.end(); ++it) {
-		if (it->first->active() > 0 && it->second->hydro() > 0) {
-			dimer_cells1.push_back(it->first);
-			dimer_cells2.push_back(it->second);
-		} else if (it->second->active() > 0 && it->first->hydro() > 0) {
-			dimer_cells1.push_back(it->second);
-			dimer_cells2.push_back(it->first);
+	const IndexedSet& dimers = _dimers[MIGRATING_DIMER];
+	unsigned int dimers_num = dimers.size();
+	_migrated_hydrogen_atoms_num = (int)(dimers_num * _k_migrate_H_dt + 0.5);
+	if (_migrated_hydrogen_atoms_num > (int)dimers_num) _migrated_hydrogen_atoms_num = dimers_num;
+
+	unsigned int j;
+	if (byDomains()) {
+		clearDomains();
+		for (j = 0; j < dimers.size(); ++j) _domains[domainOf(dimers[j])].sites.push_back(dimers[j]);
+		shareEvents(_migrated_hydrogen_atoms_num, true, _random[HYDROGEN_MIGRATION]);
+		inDomains(&Automata::migratingHydrogenIn, false);
+		return;
+	}
+
+	// случайный набор различных номеров димеров (алгоритм Флойда); миграция водорода оставляет
+	// димер в той же корзине, поэтому номера не сбиваются по ходу миграций
+	std::set<unsigned int> indexes;
+	for (j = dimers_num - _migrated_hydrogen_atoms_num; j < dimers_num; ++j) {
+		unsigned int random_index = _random[HYDROGEN_MIGRATION].bounded(j + 1);
+		if (!indexes.insert(random_index).second) indexes.insert(j);
+	}
+
+	for (std::set<unsigned int>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+		SiteId first = dimers[*it];
+		SiteId second = partnerSite(first);
+		if (_lattice[first].active() > 0 && _lattice[second].hydro() > 0) migrateHydrogen(first, second);
+		else migrateHydrogen(second, first);
+	}
+}
+
+void Automata::migratingHydrogenIn(Domain& domain) {
+	// в sites остаются узлы с активной связью, в partners - их партнёры с водородом
+	VariantSites& dimer_sites1 = domain.sites;
+	VariantSites& dimer_sites2 = domain.partners;
+	unsigned int n = 0;
+	for (unsigned int j = 0; j < dimer_sites1.size(); ++j) {
+		SiteId first = dimer_sites1[j];
+		SiteId second = partnerSite(first);
+		if (_lattice[first].active() > 0 && _lattice[second].hydro() > 0) {
+			dimer_sites1[n] = first;
+			dimer_sites2.push_back(second);
+			++n;
+		} else if (_lattice[second].active() > 0 && _lattice[first].hydro() > 0) {
+			dimer_sites1[n] = second;
+			dimer_sites2.push_back(first);
+			++n;
 		}
 	}
+	dimer_sites1.resize(n);
+
+	Random& random = domain.random[HYDROGEN_MIGRATION];
+	if (domain.events_num > (int)n) domain.events_num = n;
+	for (int i = 0; i < domain.events_num; ++i) {
+		unsigned int random_index = random.bounded(dimer_sites1.size());
+		migrateHydrogen(dimer_sites1[random_index], dimer_sites2[random_index]);
+		removeAt(dimer_sites1, random_index);
+		removeAt(dimer_sites2, random_index);
+	}
+}
 
-	_migrated_hydrogen_atoms_num = (int)(dimer_cells1.size() * _k_migrate_H_dt + 0.5);
-	for (int i = 0; i < _migrated_hydrogen_atoms_num; ++i) {
-		unsigned int random_index = rand() % dimer_cells1.size();
+void Automata::activatingSurface() {
+	_abstracted_hydrogen_atoms_num = (int)(_population.hydrogen_atoms_num * _k_abs_H_dt + 0.5);
+	if (byDomains()) {
+		clearDomains();
+		for (unsigned int i = 0; i < _hydrides.size(); ++i) {
+			_domains[domainOf(_hydrides[i])].sites.push_back(_hydrides[i]);
+		}
+		shareEvents(_abstracted_hydrogen_atoms_num, false, _random[SURFACE_ACTIVATION]);
+		inDomains(&Automata::activatingSurfaceIn, false);
+		return;
+	}
 
-		VariantCells::iterator dcit1 = dimer_cells1.begin() + random_index;
-		VariantCells::iterator dcit2 = dimer_cells2.begin() + random_index;
+	// узел, потерявший последний водород, сам покидает _hydrides
+	for (int i = 0; i < _abstracted_hydrogen_atoms_num && !_hydrides.empty(); ++i) {
+		removeHydrogen(_hydrides[_random[SURFACE_ACTIVATION].bounded(_hydrides.size())]);
+	}
+}
 
-		(*dcit1)->addHydrogen();
-		_actives.erase(*dcit1);
-		_hydrides.insert(*dcit1);
+void Automata::activatingSurfaceIn(Domain& domain) {
+	VariantSites& hydrides = domain.sites;
+	Random& random = domain.random[SURFACE_ACTIVATION];
+	for (int i = 0; i < domain.events_num && !hydrides.empty(); ++i) {
+		unsigned int random_index = random.bounded(hydrides.size());
+		removeHydrogen(hydrides[random_index]);
+		if (_lattice[hydrides[random_index]].hydro() == 0) removeAt(hydrides, random_index);
+	}
+}
 
-		(*dcit2)->removeHydrogen();
-		_actives.insert(*dcit2);
-		_hydrides.erase(*dcit2);
+void Automata::deactivatingSurface() {
+	_adsorbed_hydrogen_atoms_num = (int)(_population.active_bonds_num * _k_add_H_dt + 0.5);
+	if (byDomains()) {
+		clearDomains();
+		for (unsigned int i = 0; i < _actives.size(); ++i) {
+			_domains[domainOf(_actives[i])].sites.push_back(_actives[i]);
+		}
+		shareEvents(_adsorbed_hydrogen_atoms_num, false, _random[SURFACE_DEACTIVATION]);
+		inDomains(&Automata::deactivatingSurfaceIn, false);
+		return;
+	}
 
-		dimer_cells1.erase(dcit1);
-		dimer_cells2.erase(dcit2);
+	// узел, у которого не осталось активных связей, сам покидает _actives
+	for (int i = 0; i < _adsorbed_hydrogen_atoms_num && !_actives.empty(); ++i) {
+		addHydrogen(_actives[_random[SURFACE_DEACTIVATION].bounded(_actives.size())]);
 	}
 }
 
-void Automata::activatingSurface() {
-	VariantCells cells_with_hydro(_hydrides.size());
-	int i = 0;
-	_hydrogen_atoms_num = 0;
-	for (SetOfCells::const_iterator it = _hydrides.begin(); it != _hydrides.end(); ++it) {
-		cells_with_hydro[i++] = *it;
-		_hydrogen_atoms_num += (*it)->hydro();
+void Automata::deactivatingSurfaceIn(Domain& domain) {
+	VariantSites& actives = domain.sites;
+	Random& random = domain.random[SURFACE_DEACTIVATION];
+	for (int i = 0; i < domain.events_num && !actives.empty(); ++i) {
+		unsigned int random_index = random.bounded(actives.size());
+		addHydrogen(actives[random_index]);
+		if (_lattice[actives[random_index]].active() == 0) removeAt(actives, random_index);
 	}
+}
 
-	_abstracted_hydrogen_atoms_num = (int)(_hydrogen_atoms_num * _k_abs_H_dt + 0.5);
-	for (i = 0; i < _abstracted_hydrogen_atoms_num; ++i) {
-		unsigned int random_index = rand() % cells_with_hydro.size();
-		VariantCells::iterator hcit = cells_with_hydro.begin() + random_index;
+void Automata::addingBridges() {
+	_active_dimers_num = activeDimersNum();
+	_adsorbed_methyl_radicals_num = (int)(_active_dimers_num * _k_add_CH3_dt + 0.5);
 
-		(*hcit)->removeHydrogen();
-		_actives.insert(*hcit);
+	if (byDomains()) {
+		clearDomains();
+		for (int j = 0; j < _active_dimers_num; ++j) _domains[domainOf(activeDimer(j))].sites.push_back(activeDimer(j));
+		shareEvents(_adsorbed_methyl_radicals_num, true, _random[METHYL_ADSORPTION]);
+		// у каждого димера свой верхний узел, так что плитки не пересекаются по изменениям
+		inDomains(&Automata::addingBridgesIn, false);
+		return;
+	}
 
-		if ((*hcit)->hydro() > 0) continue;
+	// димер, на который сел метил, сам покидает корзину
+	for (int i = 0; i < _adsorbed_methyl_radicals_num && activeDimersNum() > 0; ++i) {
+		SiteId first_site = activeDimer(_random[METHYL_ADSORPTION].bounded(activeDimersNum()));
+		SiteId second_site = partnerSite(first_site);
 
-		_hydrides.erase(*hcit);
-		cells_with_hydro.erase(hcit);
+		// если активны оба конца, метил садится на любой с равной вероятностью
+		bool first_active = _lattice[first_site].active() > 0;
+		bool second_active = _lattice[second_site].active() > 0;
+		if (!first_active || (second_active && _random[METHYL_ADSORPTION].bounded(2) == 1)) {
+			std::swap(first_site, second_site);
+		}
+		adsorbMethyl(first_site, second_site);
 	}
 }
 
-void Automata::deactivatingSurface() {
-	VariantCells active_cells(_actives.size());
-	int i = 0;
-	_active_bonds_num = 0;
-	for (SetOfCells::const_iterator it = _actives.begin(); it != _actives.end(); ++it) {
-		active_cells[i++] = *it;
-		_active_bonds_num += (*it)->active();
+void Automata::addingBridgesIn(Domain& domain) {
+	Random& random = domain.random[METHYL_ADSORPTION];
+	VariantSites& ad_sites1 = domain.sites;
+	VariantSites& ad_sites2 = domain.partners;
+	unsigned int n = 0;
+	for (unsigned int j = 0; j < ad_sites1.size(); ++j) {
+		SiteId first_site = ad_sites1[j];
+		SiteId second_site = partnerSite(first_site);
+		int first_active = _lattice[first_site].active();
+		int second_active = _lattice[second_site].active();
+		if (first_active == 0 && second_active == 0) continue;
+
+		if (first_active > 0 && (second_active == 0 || random.bounded(2) == 0)) {
+			ad_sites1[n] = first_site;
+			ad_sites2.push_back(second_site);
+		} else {
+			ad_sites1[n] = second_site;
+			ad_sites2.push_back(first_site);
+		}
+		++n;
+	}
+	ad_sites1.resize(n);
+
+	if (domain.events_num > (int)n) domain.events_num = n;
+	for (int i = 0; i < domain.events_num; ++i) {
+		unsigned int random_index = random.bounded(ad_sites1.size());
+		adsorbMethyl(ad_sites1[random_index], ad_sites2[random_index]);
+		removeAt(ad_sites1, random_index);
+		removeAt(ad_sites2, random_index);
 	}
+}
 
-	_adsorbed_hydrogen_atoms_num = (int)(_active_bonds_num * _k_add_H_dt + 0.5);
-	for (i = 0; i < _adsorbed_hydrogen_atoms_num; ++i) {
-		unsigned int random_index = rand() % active_cells.size();
-		VariantCells::iterator acit = active_cells.begin() + random_index;
+void Automata::migratingBridges() {
+	// порядок обхода фиксируется в начале шага
+	VariantSites bridge_sites;
+	bridge_sites.reserve(_bridges.size());
+	unsigned int j;
+	for (j = 0; j < _bridges.size(); ++j) bridge_sites.push_back(_bridges[j]);
 
-		(*acit)->addHydrogen();
-		_hydrides.insert(*acit);
+//	_active_bridges_num = 0;
+	_bridges_num = 0;
+	_migrated_bridges_num = 0;
+
+	// узлы, в которые мигрировали мостовые группы на этом шаге
+	_migrated_sites.clear();
+
+	if (byDomains()) {
+		clearDomains();
+		for (j = 0; j < bridge_sites.size(); ++j) _domains[domainOf(bridge_sites[j])].sites.push_back(bridge_sites[j]);
+		inDomains(&Automata::migratingBridgesIn, true);
+		sumDomains(_migrated_bridges_num, &_bridges_num);
+		return;
+	}
 
-		if ((*acit)->active() > 0) continue;
+	// по одному случайному слову на каждую мостовую группу, одним блоком
+	std::vector<uint32_t> random_words(bridge_sites.size());
+	if (!random_words.empty()) _random[BRIDGE_MIGRATION].fill(&random_words[0], random_words.size());
 
-		_actives.erase(*acit);
-		active_cells.erase(acit);
+	for (unsigned int ib = 0; ib < bridge_sites.size(); ++ib) {
+		SiteId current_site = bridge_sites[ib];
+		if (_migrated_sites.count(current_site) > 0) continue;
+		SiteId to_site = tryMigrateBridge(current_site, random_words[ib], _bridges_num);
+		if (to_site == Lattice::NO_SITE) continue;
+		++_migrated_bridges_num;
+		_migrated_sites.insert(to_site);
 	}
 }
 
-void Automata::addingBridges() {
-	VariantCells ad_cells1, ad_cells2;
-	for (CellToCell::iterator it = _dimer_bonds.begin(); it != _dimer_bonds.end(); ++it) {
-		if (it->first->active() > 0 && it->second->active() > 0) {
-			if (rand() % 2 == 0) {
-				ad_cells1.push_back(it->first);
-				ad_cells2.push_back(it->second);
-			} else {
-				ad_cells1.push_back(it->second);
-				ad_cells2.push_back(it->first);
-			}
-		} else if (it->first->active() > 0) {
-			ad_cells1.push_back(it->first);
-			ad_cells2.push_back(it->second);
-		} else if (it->second->active() > 0) {
-			ad_cells1.push_back(it->second);
-			ad_cells2.push_back(it->first);
-		}
+void Automata::migratingBridgesIn(Domain& domain) {
+	Random& random = domain.random[BRIDGE_MIGRATION];
+	for (unsigned int ib = 0; ib < domain.sites.size(); ++ib) {
+		SiteId current_site = domain.sites[ib];
+		if (_migrated_sites.count(current_site) > 0 || domain.migrated.count(current_site) > 0) continue;
+		SiteId to_site = tryMigrateBridge(current_site, random.next(), domain.candidates_num);
+		if (to_site == Lattice::NO_SITE) continue;
+		++domain.events_num;
+		domain.migrated.insert(to_site);
 	}
+}
 
-	_active_dimers_num = ad_cells1.size();
-	_adsorbed_methyl_radicals_num = (int)(_active_dimers_num * _k_add_CH3_dt + 0.5);
-	for (int i = 0; i < _adsorbed_methyl_radicals_num; ++i) {
-		unsigned int random_index = rand() % ad_cells1.size();
+// возвращает узел, в который мигрировала мостовая группа, или NO_SITE
+SiteId Automata::tryMigrateBridge(SiteId current_site, uint32_t random_word, int& bridges_num) {
+	if (!isBridge(_lattice[current_site])) return Lattice::NO_SITE;
+//	++_active_bridges_num;
+	++bridges_num;
 
-		VariantCells::iterator adcit1 = ad_cells1.begin() + random_index;
-		VariantCells::iterator adcit2 = ad_cells2.begin() + random_index;
+	Destinations buffer;
+	const Destinations& destinations = cachedBridgeDestinations(current_site, buffer);
+	if (destinations.empty()) return Lattice::NO_SITE;
 
-		deleteDimer(*adcit1, *adcit2);
+	// либо мигрирует, либо остаётся на месте
+	unsigned int random_index = ((uint64_t)random_word * (destinations.size() + 1)) >> 32;
+	if (random_index == destinations.size()) return Lattice::NO_SITE;
 
-		int3 top_n_coords;
-		topNeighbourCoords((*adcit1)->coords(), (*adcit2)->coords(), top_n_coords);
-		_cells[top_n_coords.z][top_n_coords.y][top_n_coords.x] =
-				new Cell("HH", top_n_coords.z, top_n_coords.y, top_n_coords.x);
+	// кэш меняется при миграции, поэтому назначение копируется
+	int3 to_coords = destinations[random_index];
+	return migrateBridge(current_site, to_coords);
+}
 
-		_hydrides.insert(_cells[top_n_coords.z][top_n_coords.y][top_n_coords.x]);
+// назначения из кэша, если узел уже учтён в _bridges, иначе вычисленные заново в buffer
+const Destinations& Automata::cachedBridgeDestinations(SiteId site, Destinations& buffer) {
+	unsigned int index = _bridges.indexOf(site);
+	if (index == IndexedSet::NO_INDEX) {
+		buffer.clear();
+		bridgeDestinations(site, buffer);
+		return buffer;
+	}
 
-		++_carbons_num;
-		if (top_n_coords.z > _max_z) _max_z = top_n_coords.z;
+	// мостовая группа просматривает узлы не дальше трёх клеток по X и Y от себя
+	CachedDestinations& cached = _bridges_destinations[index];
+	if (cached.epoch == 0 || _changes.latestAround(_lattice.coords(site), 3) >= cached.epoch) {
+		cached.coords.clear();
+		bridgeDestinations(site, cached.coords);
+		cached.epoch = _epoch;
+	}
+	return cached.coords;
+}
 
-		(*adcit1)->addHydrogen();
-		_hydrides.insert(*adcit1);
-		_actives.erase(*adcit1);
+void Automata::clearDomains() {
+	for (unsigned int t = 0; t < _domains.size(); ++t) {
+		Domain& domain = _domains[t];
+		domain.sites.clear();
+		domain.partners.clear();
+		domain.migrated.clear();
+		domain.candidates_num = 0;
+		domain.events_num = 0;
+	}
+}
 
-		ad_cells1.erase(adcit1);
-		ad_cells2.erase(adcit2);
+void Automata::inDomains(DomainFunc func, bool by_colors) {
+	int phases_num = (by_colors) ? Checkerboard::COLORS_NUM : 1;
+	for (int color = 0; color < phases_num; ++color) {
+		const TilesList& tiles = (by_colors) ? _checkerboard.tilesOfColor(color) : _checkerboard.allTiles();
+		PoolTask task = [this, func, &tiles](unsigned int i) {
+			Domain& domain = _domains[tiles[i]];
+			domain.changes.clear();
+			domain.population.clear();
+			_deferred_domain = &domain;
+			(this->*func)(domain);
+			_deferred_domain = 0;
+		};
+		_pool->run(tiles.size(), task);
+
+		// изменения применяются в порядке плиток, чтобы порядок множеств не зависел от числа потоков
+		for (unsigned int t = 0; t < tiles.size(); ++t) {
+			Domain& domain = _domains[tiles[t]];
+			for (unsigned int j = 0; j < domain.changes.size(); ++j) syncSite(domain.changes[j]);
+			_population.merge(domain.population);
+			_migrated_sites.insert(domain.migrated.begin(), domain.migrated.end());
+		}
 	}
 }
 
-void Automata::migratingBridges() {
-//	SetOfCells* actives_not_dimer = differentCells(_actives, _dimers);
-	SetOfCells* surface_cells = unionCells(_actives, _hydrides);
-	SetOfCells* bridge_cells = differentCells(*surface_cells, _dimers);
-	delete surface_cells;
+void Automata::shareEvents(int events_num, bool is_distinct, Random& random) {
+	// границы кандидатов доменов в общей нумерации
+	std::vector<unsigned int> ends(_domains.size());
+	unsigned int candidates_num = 0;
+	for (unsigned int t = 0; t < _domains.size(); ++t) {
+		candidates_num += _domains[t].sites.size();
+		ends[t] = candidates_num;
+	}
+	if (candidates_num == 0) return;
+
+	std::vector<unsigned int> indexes;
+	if (is_distinct) {
+		// различные номера кандидатов (алгоритм Флойда)
+		if (events_num > (int)candidates_num) events_num = candidates_num;
+		std::set<unsigned int> chosen;
+		for (unsigned int j = candidates_num - events_num; j < candidates_num; ++j) {
+			unsigned int random_index = random.bounded(j + 1);
+			if (!chosen.insert(random_index).second) chosen.insert(j);
+		}
+		indexes.assign(chosen.begin(), chosen.end());
+	} else {
+		for (int i = 0; i < events_num; ++i) indexes.push_back(random.bounded(candidates_num));
+	}
 
-//	_active_bridges_num = 0;
-	_bridges_num = 0;
-	_migrated_bridges_num = 0;
-//	for (SetOfCells::iterator it = actives_not_dimer->begin(); it != actives_not_dimer->end(); ++it) {
-	for (SetOfCells::iterator it = bridge_cells->begin(); it != bridge_cells->end(); ++it) {
-		Cell* current_cell = *it;
-		if (!(current_cell->active() + current_cell->hydro() > 1)) continue;
-//		++_active_bridges_num;
-		++_bridges_num;
-
-		int3 current_coords = current_cell->coords();
-
-		Cell* bottom_n_cells[2];
-		bottomNeighboursCells(current_coords, bottom_n_cells);
-
-		VariantCoords empty_cells_coords;
-
-		int i;
-		int3 flat_n_coords[2][2];
-		flatNeighboursCoords(current_coords, flat_n_coords);
-
-//		// если есть 2 соседа в плоскости - не мигрирует
-//		int nn = 0;
-//		for (i = 0; i < 2; ++i) {
-//			for (int j = 0; j < 2; ++j) {
-//				if (!getCell(flat_n_coords[i][j])) continue;
-//				++nn;
-//			}
+	for (unsigned int i = 0; i < indexes.size(); ++i) {
+		unsigned int t = std::upper_bound(ends.begin(), ends.end(), indexes[i]) - ends.begin();
+		++_domains[t].events_num;
+	}
+}
+
+void Automata::sumDomains(int& events_num, int* candidates_num) const {
+	events_num = 0;
+	if (candidates_num) *candidates_num = 0;
+	for (unsigned int t = 0; t < _domains.size(); ++t) {
+		events_num += _domains[t].events_num;
+		if (candidates_num) *candidates_num += _domains[t].candidates_num;
+	}
+}
+
+void Automata::bridgeDestinations(SiteId current_site, Destinations& destinations) {
+	int3 current_coords = _lattice.coords(current_site);
+
+	SiteId bottom_n_sites[2];
+	bottomNeighboursSites(current_coords, bottom_n_sites);
+
+	int i;
+	int3 flat_n_coords[2][2];
+	flatNeighboursCoords(current_coords, flat_n_coords);
+
+//	// если есть 2 соседа в плоскости - не мигрирует
+//	int nn = 0;
+//	for (i = 0; i < 2; ++i) {
+//		for (int j = 0; j < 2; ++j) {
+//			if (getSite(flat_n_coords[i][j]) == Lattice::NO_SITE) continue;
+//			++nn;
 //		}
-//		if (nn > 1) continue;
-
-		int3* direct_n_coords = flat_n_coords[0];
-		int3* across_n_coords = flat_n_coords[1];
-
-		for (i = 0; i < 2; ++i) {
-			Cell* direct_n_cell = getCell(direct_n_coords[i]);
-			if (!direct_n_cell) {
-				int3 direct_bottom_n_coords[2];
-				bottomNeighboursCoords(direct_n_coords[i], direct_bottom_n_coords);
-				Cell* direct_bottom_n_cells[2];
-				for (int idc = 0; idc < 2; ++idc) direct_bottom_n_cells[idc] = getCell(direct_bottom_n_coords[idc]);
-
-				if (isAvailableForMigrating(direct_bottom_n_cells)) {
-					empty_cells_coords.push_back(direct_n_coords[i]);
-				} else if (_config["bridge-migration-up-down"]) {
-					// миграция вниз
-					for (int ibc = 0; ibc < 2; ++ibc) {
-						if (direct_bottom_n_cells[ibc] || bottom_n_cells[ibc]->active() != 1) continue;
-						Cell* bottom_bottom_n_cells[2];
-						bottomNeighboursCells(direct_bottom_n_coords[ibc], bottom_bottom_n_cells);
-						if (!isAvailableForMigrating(bottom_bottom_n_cells)) continue;
-						if (!isCanDirectMigrating(current_cell, direct_bottom_n_coords[ibc])) continue;
-						empty_cells_coords.push_back(direct_bottom_n_coords[ibc]);
-					}
+//	}
+//	if (nn > 1) return;
+
+	int3* direct_n_coords = flat_n_coords[0];
+	int3* across_n_coords = flat_n_coords[1];
+
+	for (i = 0; i < 2; ++i) {
+		SiteId direct_n_site = getSite(direct_n_coords[i]);
+		if (direct_n_site == Lattice::NO_SITE) {
+			int3 direct_bottom_n_coords[2];
+			bottomNeighboursCoords(direct_n_coords[i], direct_bottom_n_coords);
+			SiteId direct_bottom_n_sites[2];
+			for (int idc = 0; idc < 2; ++idc) direct_bottom_n_sites[idc] = getSite(direct_bottom_n_coords[idc]);
+
+			if (isAvailableForMigrating(direct_bottom_n_sites)) {
+				destinations.push_back(direct_n_coords[i]);
+			} else if (enabled(WITH_BRIDGE_MIGRATION_UP_DOWN)) {
+				// миграция вниз
+				for (int ibc = 0; ibc < 2; ++ibc) {
+					if (direct_bottom_n_sites[ibc] != Lattice::NO_SITE
+							|| _lattice[bottom_n_sites[ibc]].active() != 1) continue;
+					SiteId bottom_bottom_n_sites[2];
+					bottomNeighboursSites(direct_bottom_n_coords[ibc], bottom_bottom_n_sites);
+					if (!isAvailableForMigrating(bottom_bottom_n_sites)) continue;
+					if (!isCanDirectMigrating(current_site, direct_bottom_n_coords[ibc])) continue;
+					destinations.push_back(direct_bottom_n_coords[ibc]);
 				}
-			} else if (direct_n_cell->hydro() == 0 && direct_n_cell->active() == 1 &&
-					_config["bridge-migration-up-down"])
-			{
-				// миграция вверх
-				Cell* other_direct_n_cell = getCell(direct_n_coords[1-i]);
-				if (other_direct_n_cell || (getCell(across_n_coords[0]) && getCell(across_n_coords[1]))) continue;
-
-				int3 direct_direct_n_coords[2];
-				directNeighboursCoords(direct_n_coords[i], direct_direct_n_coords);
-				Cell* direct_direct_n_cells[2];
-				int iddc;
-				for (iddc = 0; iddc < 2; ++iddc) direct_direct_n_cells[iddc] = getCell(direct_direct_n_coords[iddc]);
-				for (iddc = 0; iddc < 2; ++iddc) {
-					if (current_cell == direct_direct_n_cells[1-iddc] &&
-							isAvailableForMigrating(direct_n_cell, direct_direct_n_cells[iddc]))
-					{
-						int3 top_direct_n_coords;
-						topNeighbourCoords(direct_n_coords[i], direct_direct_n_coords[iddc], top_direct_n_coords);
-						if (getCell(top_direct_n_coords)) continue;
-						empty_cells_coords.push_back(top_direct_n_coords);
-					}
+			}
+		} else if (_lattice[direct_n_site].hydro() == 0 && _lattice[direct_n_site].active() == 1 &&
+				enabled(WITH_BRIDGE_MIGRATION_UP_DOWN))
+		{
+			// миграция вверх
+			SiteId other_direct_n_site = getSite(direct_n_coords[1-i]);
+			if (other_direct_n_site != Lattice::NO_SITE || (getSite(across_n_coords[0]) != Lattice::NO_SITE
+					&& getSite(across_n_coords[1]) != Lattice::NO_SITE)) continue;
+
+			int3 direct_direct_n_coords[2];
+			directNeighboursCoords(direct_n_coords[i], direct_direct_n_coords);
+			SiteId direct_direct_n_sites[2];
+			int iddc;
+			for (iddc = 0; iddc < 2; ++iddc) direct_direct_n_sites[iddc] = getSite(direct_direct_n_coords[iddc]);
+			for (iddc = 0; iddc < 2; ++iddc) {
+				if (current_site == direct_direct_n_sites[1-iddc] &&
+						isAvailableForMigrating(direct_n_site, direct_direct_n_sites[iddc]))
+				{
+					int3 top_direct_n_coords;
+					topNeighbourCoords(direct_n_coords[i], direct_direct_n_coords[iddc], top_direct_n_coords);
+					if (getSite(top_direct_n_coords) != Lattice::NO_SITE) continue;
+					destinations.push_back(top_direct_n_coords);
 				}
 			}
 		}
+	}
 
-		for (i = 0; i < 2; ++i) {
-			Cell* across_n_cell = getCell(across_n_coords[i]);
-			if (!across_n_cell) {
-				int3 across_bottom_n_coords[2];
-				bottomNeighboursCoords(across_n_coords[i], across_bottom_n_coords);
-				Cell* across_bottom_n_cells[2];
-				for (int iac = 0; iac < 2; ++iac) across_bottom_n_cells[iac] = getCell(across_bottom_n_coords[iac]);
-
-				if (isAvailableForMigrating(across_bottom_n_cells)) {
-					if (!isCanDirectMigrating(current_cell, across_n_coords[i])) continue;
-					empty_cells_coords.push_back(across_n_coords[i]);
-				} else if (_config["bridge-migration-up-down"]) {
-					// миграция вниз
-					for (int iabc = 0; iabc < 2; ++iabc) {
-						if (across_bottom_n_cells[iabc] || across_bottom_n_cells[1-iabc]->hydro() != 0) continue;
-
-						Cell* bottom_bottom_n_cells[2];
-						bottomNeighboursCells(across_bottom_n_coords[iabc], bottom_bottom_n_cells);
-						if (!isAvailableForMigrating(bottom_bottom_n_cells)) continue;
-						empty_cells_coords.push_back(across_bottom_n_coords[iabc]);
-					}
-				}
-			} else if (across_n_cell->hydro() == 0 && across_n_cell->active() == 1 &&
-					_config["bridge-migration-up-down"])
-			{
-				// миграция вверх
-				Cell* other_across_n_cell = getCell(across_n_coords[1-i]);
-				if (other_across_n_cell || (getCell(direct_n_coords[0]) && getCell(direct_n_coords[1]))) continue;
-
-				int3 direct_across_n_coords[2];
-				directNeighboursCoords(across_n_coords[i], direct_across_n_coords);
-				Cell* direct_across_n_cells[2];
-				int idac;
-				for (idac = 0; idac < 2; ++idac) direct_across_n_cells[idac] = getCell(direct_across_n_coords[idac]);
-				for (idac = 0; idac < 2; ++idac) {
-					if (!isAvailableForMigrating(across_n_cell, direct_across_n_cells[idac])) continue;
-					int3 top_direct_across_n_coords;
-					topNeighbourCoords(across_n_coords[i], direct_across_n_coords[idac], top_direct_across_n_coords);
-					if (getCell(top_direct_across_n_coords)) continue;
-					if (!isCanDirectMigrating(current_cell, top_direct_across_n_coords)) continue;
-					empty_cells_coords.push_back(top_direct_across_n_coords);
+	for (i = 0; i < 2; ++i) {
+		SiteId across_n_site = getSite(across_n_coords[i]);
+		if (across_n_site == Lattice::NO_SITE) {
+			int3 across_bottom_n_coords[2];
+			bottomNeighboursCoords(across_n_coords[i], across_bottom_n_coords);
+			SiteId across_bottom_n_sites[2];
+			for (int iac = 0; iac < 2; ++iac) across_bottom_n_sites[iac] = getSite(across_bottom_n_coords[iac]);
+
+			if (isAvailableForMigrating(across_bottom_n_sites)) {
+				if (!isCanDirectMigrating(current_site, across_n_coords[i])) continue;
+				destinations.push_back(across_n_coords[i]);
+			} else if (enabled(WITH_BRIDGE_MIGRATION_UP_DOWN)) {
+				// миграция вниз
+				for (int iabc = 0; iabc < 2; ++iabc) {
+					if (across_bottom_n_sites[iabc] != Lattice::NO_SITE
+							|| across_bottom_n_sites[1-iabc] == Lattice::NO_SITE
+							|| _lattice[across_bottom_n_sites[1-iabc]].hydro() != 0) continue;
+
+					SiteId bottom_bottom_n_sites[2];
+					bottomNeighboursSites(across_bottom_n_coords[iabc], bottom_bottom_n_sites);
+					if (!isAvailableForMigrating(bottom_bottom_n_sites)) continue;
+					destinations.push_back(across_bottom_n_coords[iabc]);
 				}
 			}
+		} else if (_lattice[across_n_site].hydro() == 0 && _lattice[across_n_site].active() == 1 &&
+				enabled(WITH_BRIDGE_MIGRATION_UP_DOWN))
+		{
+			// миграция вверх
+			SiteId other_across_n_site = getSite(across_n_coords[1-i]);
+			if (other_across_n_site != Lattice::NO_SITE || (getSite(direct_n_coords[0]) != Lattice::NO_SITE
+					&& getSite(direct_n_coords[1]) != Lattice::NO_SITE)) continue;
+
+			int3 direct_across_n_coords[2];
+			directNeighboursCoords(across_n_coords[i], direct_across_n_coords);
+			SiteId direct_across_n_sites[2];
+			int idac;
+			for (idac = 0; idac < 2; ++idac) direct_across_n_sites[idac] = getSite(direct_across_n_coords[idac]);
+			for (idac = 0; idac < 2; ++idac) {
+				if (!isAvailableForMigrating(across_n_site, direct_across_n_sites[idac])) continue;
+				int3 top_direct_across_n_coords;
+				topNeighbourCoords(across_n_coords[i], direct_across_n_coords[idac], top_direct_across_n_coords);
+				if (getSite(top_direct_across_n_coords) != Lattice::NO_SITE) continue;
+				if (!isCanDirectMigrating(current_site, top_direct_across_n_coords)) continue;
+				destinations.push_back(top_direct_across_n_coords);
+			}
 		}
+	}
+}
 
-		if (empty_cells_coords.empty()) continue;
+SiteId Automata::migrateBridge(SiteId site, const int3& to_coords) {
+	SiteId bottom_n_sites[2];
+	bottomNeighboursSites(_lattice.coords(site), bottom_n_sites);
 
-		// либо мигрирует, либо остаётся на месте
-		unsigned int random_index = rand() % (empty_cells_coords.size() + 1);
-		if (random_index == empty_cells_coords.size()) continue;
+	SiteId neighbour_bottom_n_sites[2];
+	bottomNeighboursSites(to_coords, neighbour_bottom_n_sites);
 
-		++_migrated_bridges_num;
+	if (isDimer(neighbour_bottom_n_sites)) {
+		deleteDimer(neighbour_bottom_n_sites[0], neighbour_bottom_n_sites[1]);
+	} else {
+		deactivate(neighbour_bottom_n_sites[0]);
+		deactivate(neighbour_bottom_n_sites[1]);
+	}
 
-		VariantCoords::const_iterator rcit = empty_cells_coords.begin() + random_index;
-		Cell* neighbour_bottom_n_cells[2];
-		bottomNeighboursCells(*rcit, neighbour_bottom_n_cells);
+	activate(bottom_n_sites[0]);
+	activate(bottom_n_sites[1]);
 
-		if (isDimer(neighbour_bottom_n_cells)) {
-			deleteDimer(neighbour_bottom_n_cells[0], neighbour_bottom_n_cells[1]);
-		} else {
-			deactivate(neighbour_bottom_n_cells[0]);
-			deactivate(neighbour_bottom_n_cells[1]);
-		}
+	SiteId to_site = _lattice.site(to_coords);
+	moveCell(site, to_site);
+	return to_site;
+}
 
-		activate(bottom_n_cells[0]);
-		activate(bottom_n_cells[1]);
+bool Automata::isDimerFormable(SiteId site, int partner) {
+	int3 coords = _lattice.coords(site);
+	int3 direct_n_coords[2];
+	directNeighboursCoords(coords, direct_n_coords);
 
-		current_cell->setCoords(*rcit);
-		_cells[rcit->z][rcit->y][rcit->x] = current_cell;
-		_cells[current_coords.z][current_coords.y][current_coords.x] = 0;
-	}
+	SiteId direct_n_site = getSite(direct_n_coords[partner]);
+	if (direct_n_site == Lattice::NO_SITE || _lattice[direct_n_site].active() == 0
+			|| _lattice[direct_n_site].isDimer()) return false;
 
-//	delete actives_not_dimer;
-	delete bridge_cells;
+	int3 top_n_coords;
+	topNeighbourCoords(coords, direct_n_coords[partner], top_n_coords);
+	return getSite(top_n_coords) == Lattice::NO_SITE;
 }
 
-SetOfCells* Automata::unionCells(const SetOfCells& s1, const SetOfCells& s2) {
-	SetOfCells* result = new SetOfCells;
-	std::set_union(s1.begin(), s1.end(), s2.begin(), s2.end(), std::inserter(*result, result->begin()));
-	return result;
+// пара узла с его бо́льшим прямым соседом
+bool Automata::isPairFormable(SiteId site) {
+	const Cell& cell = _lattice[site];
+	return !cell.empty() && cell.active() > 0 && !cell.isDimer() && isDimerFormable(site, 1);
 }
 
-SetOfCells* Automata::differentCells(const SetOfCells& s1, const SetOfCells& s2) {
-	SetOfCells* result = new SetOfCells;
-	std::set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(), std::inserter(*result, result->end()));
-	return result;
-}
+// изменение узла влияет на пары, в которые он входит, и на пару, над которой он лежит
+void Automata::updateFormablePairs(SiteId site) {
+	int3 coords = _lattice.coords(site);
+	SiteId sites[3];
+	int sites_num = 0;
 
-bool Automata::isCanDirectMigrating(Cell* cell, const int3& to_coords) {
-	if (cell->active() > 0) return true;
+	sites[sites_num++] = site;
 
 	int3 direct_n_coords[2];
-	directNeighboursCoords(to_coords, direct_n_coords);
-	Cell* direct_n_cells[2];
-	for (int i = 0; i < 2; ++i) direct_n_cells[i] = getCell(direct_n_coords[i]);
-	return (!direct_n_cells[0] || !direct_n_cells[1] ||
-			direct_n_cells[0]->active() > 0 || direct_n_cells[1]->active() > 0);
-}
+	directNeighboursCoords(coords, direct_n_coords);
+	sites[sites_num++] = _lattice.site(direct_n_coords[0]);
+
+	if (coords.z > 0) {
+		int3 bottom_n_coords[2];
+		bottomNeighboursCoords(coords, bottom_n_coords);
+		SiteId bottom_n_sites[2] = { _lattice.site(bottom_n_coords[0]), _lattice.site(bottom_n_coords[1]) };
+		directNeighboursCoords(bottom_n_coords[0], direct_n_coords);
+		sites[sites_num++] = (_lattice.site(direct_n_coords[1]) == bottom_n_sites[1]) ? bottom_n_sites[0] : bottom_n_sites[1];
+	}
 
-void Automata::activate(Cell* cell) {
-	cell->activate();
-	if (cell->active() > 0) _actives.insert(cell);
+	for (int i = 0; i < sites_num; ++i) {
+		if (isPairFormable(sites[i])) _formable_pairs.insert(sites[i]);
+		else _formable_pairs.erase(sites[i]);
+	}
 }
 
-void Automata::deactivate(Cell* cell) {
-	cell->deactivate();
-	if (cell->active() == 0) _actives.erase(cell);
-}
+void Automata::dropDimer(SiteId site, SiteId partner_site) {
+	activate(site);
+	activate(partner_site);
 
-void Automata::formDimerPart(Cell* cell) {
-	_dimers.insert(cell);
-	deactivate(cell);
+	deleteDimer(site, partner_site);
 }
 
-void Automata::deleteDimer(Cell* cell1, Cell* cell2) {
-	if (!_dimer_bonds.erase(cell1)) _dimer_bonds.erase(cell2);
-
-	_dimers.erase(cell1);
-	_dimers.erase(cell2);
+void Automata::migrateHydrogen(SiteId to_site, SiteId from_site) {
+	addHydrogen(to_site);
+	removeHydrogen(from_site);
 }
 
-void Automata::topNeighbourCoords(const int3& coords1, const int3& coords2, int3& top_neighbour_coords) {
-	const int3* sc1 = (coords1 < coords2) ? &coords1 : &coords2;
-	const int3* sc2 = (coords1 < coords2) ? &coords2 : &coords1;
+void Automata::adsorbMethyl(SiteId site, SiteId partner_site) {
+	deleteDimer(site, partner_site);
 
-	top_neighbour_coords.z = sc1->z + 1;
-	if (sc1->z % 2 == 1) top_neighbour_coords.y = sc1->y;
-	else top_neighbour_coords.x = sc1->x;
+	int3 top_n_coords;
+	topNeighbourCoords(_lattice.coords(site), _lattice.coords(partner_site), top_n_coords);
+	SiteId top_n_site = _lattice.site(top_n_coords);
+	Cell old_cell = _lattice[top_n_site];
+	_lattice[top_n_site].compose("HH");
+	changed(top_n_site, old_cell);
 
-    if (sc1->z % 4 == 3) {
-    	top_neighbour_coords.x = ((sc2->x - sc1->x) == 1) ? sc2->x : sc1->x;
-    } else if (sc1->z % 4 == 2) {
-    	top_neighbour_coords.y = ((sc2->y - sc1->y) == 1) ? sc2->y : sc1->y;
-    } else if (sc1->z % 4 == 1) {
-    	top_neighbour_coords.x = ((sc2->x - sc1->x) == 1) ? sc1->x : sc2->x;
-    } else { // sc1->z % 4 == 0
-    	top_neighbour_coords.y = ((sc2->y - sc1->y) == 1) ? sc1->y : sc2->y;
-    }
+	addHydrogen(site);
 }
 
-void Automata::directNeighboursCoords(const int3& current_coords, int3 direct_neighbours_coords[2]) const {
-	if (current_coords.z % 2 == 0) {
-		int less_y, more_y;
-		torusCoordinate('y', current_coords.y, less_y, more_y);
+bool Automata::isCanDirectMigrating(SiteId site, const int3& to_coords) {
+	if (_lattice[site].active() > 0) return true;
 
-		direct_neighbours_coords[0].z = current_coords.z;
-		direct_neighbours_coords[0].y = less_y;
-		direct_neighbours_coords[0].x = current_coords.x;
+	int3 direct_n_coords[2];
+	directNeighboursCoords(to_coords, direct_n_coords);
+	SiteId direct_n_sites[2];
+	for (int i = 0; i < 2; ++i) direct_n_sites[i] = getSite(direct_n_coords[i]);
+	return (direct_n_sites[0] == Lattice::NO_SITE || direct_n_sites[1] == Lattice::NO_SITE ||
+			_lattice[direct_n_sites[0]].active() > 0 || _lattice[direct_n_sites[1]].active() > 0);
+}
 
-		direct_neighbours_coords[1].z = current_coords.z;
-		direct_neighbours_coords[1].y = more_y;
-		direct_neighbours_coords[1].x = current_coords.x;
-	} else {
-		int less_x, more_x;
-		torusCoordinate('x', current_coords.x, less_x, more_x);
+void Automata::changed(SiteId site, const Cell& old_cell) {
+	_changes.mark(_lattice.coords(site), _epoch);
+	_lattice.touch(site);
 
-		direct_neighbours_coords[0].z = current_coords.z;
-		direct_neighbours_coords[0].y = current_coords.y;
-		direct_neighbours_coords[0].x = less_x;
+	Population& population = (_deferred_domain) ? _deferred_domain->population : _population;
+	population.count(old_cell, -1);
+	population.count(_lattice[site], 1);
+	if (!_lattice[site].empty()) {
+		int z = _lattice.coords(site).z;
+		if (z > population.max_z) population.max_z = z;
+	}
+	if (_layers_carbons && old_cell.empty() != _lattice[site].empty()) {
+		int z = _lattice.coords(site).z;
+		_layers_carbons[z].fetch_add(old_cell.empty() ? 1 : -1, std::memory_order_relaxed);
+	}
 
-		direct_neighbours_coords[1].z = current_coords.z;
-		direct_neighbours_coords[1].y = current_coords.y;
-		direct_neighbours_coords[1].x = more_x;
+	if (_deferred_domain) {
+		_deferred_domain->changes.push_back(site);
+		return;
 	}
 
+	syncSite(site);
+	if (_touched_sites) _touched_sites->push_back(site);
 }
 
-void Automata::flatNeighboursCoords(const int3& current_coords, int3 flat_neighbours_coords[2][2]) const {
-	int less_x, more_x;
-	torusCoordinate('x', current_coords.x, less_x, more_x);
-
-	int less_y, more_y;
-	torusCoordinate('y', current_coords.y, less_y, more_y);
+void Automata::syncSite(SiteId site) {
+	const Cell& cell = _lattice[site];
+
+	if (_is_shell_tracked) {
+		updateShell(site);
+		// узел мог появиться над нижними соседями или исчезнуть над ними
+		int3 coords = _lattice.coords(site);
+		if (coords.z > 0) {
+			int3 bottom_n_coords[2];
+			bottomNeighboursCoords(coords, bottom_n_coords);
+			for (int i = 0; i < 2; ++i) updateShell(_lattice.site(bottom_n_coords[i]));
+		}
+	}
+	if (_is_morphology_tracked) updateColumnHeight(site);
 
-	if (current_coords.z % 2 == 0) {
-		flat_neighbours_coords[0][0].z = current_coords.z;
-		flat_neighbours_coords[0][0].y = less_y;
-		flat_neighbours_coords[0][0].x = current_coords.x;
+	if (cell.active() > 0 && !cell.empty()) _actives.insert(site);
+	else _actives.erase(site);
 
-		flat_neighbours_coords[0][1].z = current_coords.z;
-		flat_neighbours_coords[0][1].y = more_y;
-		flat_neighbours_coords[0][1].x = current_coords.x;
+	if (cell.hydro() > 0 && !cell.empty()) _hydrides.insert(site);
+	else _hydrides.erase(site);
 
-		flat_neighbours_coords[1][0].z = current_coords.z;
-		flat_neighbours_coords[1][0].y = current_coords.y;
-		flat_neighbours_coords[1][0].x = less_x;
+	updateFormablePairs(site);
 
-		flat_neighbours_coords[1][1].z = current_coords.z;
-		flat_neighbours_coords[1][1].y = current_coords.y;
-		flat_neighbours_coords[1][1].x = more_x;
+	if (isBridge(cell)) {
+		if (_bridges.insert(site)) _bridges_destinations.push_back(CachedDestinations());
 	} else {
-		flat_neighbours_coords[0][0].z = current_coords.z;
-		flat_neighbours_coords[0][0].y = current_coords.y;
-		flat_neighbours_coords[0][0].x = less_x;
+		unsigned int index = _bridges.indexOf(site);
+		if (index != IndexedSet::NO_INDEX) {
+			// повторяет перестановку последнего элемента в IndexedSet::erase
+			_bridges.erase(site);
+			_bridges_destinations[index] = _bridges_destinations.back();
+			_bridges_destinations.pop_back();
+		}
+	}
 
-		flat_neighbours_coords[0][1].z = current_coords.z;
-		flat_neighbours_coords[0][1].y = current_coords.y;
-		flat_neighbours_coords[0][1].x = more_x;
+	if (!cell.isDimer()) {
+		if (_dimer_bonds.erase(site)) {
+			for (int s = 0; s < DIMER_STATES_NUM; ++s) _dimers[s].erase(site);
+		}
+		return;
+	}
 
-		flat_neighbours_coords[1][0].z = current_coords.z;
-		flat_neighbours_coords[1][0].y = less_y;
-		flat_neighbours_coords[1][0].x = current_coords.x;
+	// димер представлен тем концом, который уже учтён
+	SiteId partner_site = partnerSite(site);
+	SiteId bond_site = (_dimer_bonds.contains(partner_site)) ? partner_site : site;
+	_dimer_bonds.insert(bond_site);
 
-		flat_neighbours_coords[1][1].z = current_coords.z;
-		flat_neighbours_coords[1][1].y = more_y;
-		flat_neighbours_coords[1][1].x = current_coords.x;
+	DimerState state = dimerState(site, partner_site);
+	for (int s = 0; s < DIMER_STATES_NUM; ++s) {
+		if (s == state) _dimers[s].insert(bond_site);
+		else _dimers[s].erase(bond_site);
 	}
 }
 
-void Automata::bottomNeighboursCells(const int3& current_coords, Cell* bottom_neighbours_cells[2]) const {
-	int3 bottom_n_coords[2];
-	bottomNeighboursCoords(current_coords, bottom_n_coords);
-	for (int i = 0; i < 2; ++i) bottom_neighbours_cells[i] = getCell(bottom_n_coords[i]);
+void Automata::activate(SiteId site) {
+	Cell old_cell = _lattice[site];
+	_lattice[site].activate();
+	changed(site, old_cell);
 }
 
-void Automata::bottomNeighboursCoords(const int3& current_coords, int3 bottom_neighbours_coords[2]) const {
-	int less_x, more_x;
-	torusCoordinate('x', current_coords.x, less_x, more_x);
+void Automata::deactivate(SiteId site) {
+	Cell old_cell = _lattice[site];
+	_lattice[site].deactivate();
+	changed(site, old_cell);
+}
 
-	int less_y, more_y;
-	torusCoordinate('y', current_coords.y, less_y, more_y);
+void Automata::addHydrogen(SiteId site) {
+	Cell old_cell = _lattice[site];
+	_lattice[site].addHydrogen();
+	changed(site, old_cell);
+}
 
-	bottom_neighbours_coords[0].z = current_coords.z - 1;
-	bottom_neighbours_coords[1].z = current_coords.z - 1;
-	if (current_coords.z % 4 == 3) {
-		bottom_neighbours_coords[0].y = less_y;
-		bottom_neighbours_coords[0].x = current_coords.x;
+void Automata::removeHydrogen(SiteId site) {
+	Cell old_cell = _lattice[site];
+	_lattice[site].removeHydrogen();
+	changed(site, old_cell);
+}
 
-		bottom_neighbours_coords[1].y = current_coords.y;
-		bottom_neighbours_coords[1].x = current_coords.x;
-	} else if (current_coords.z % 4 == 2) {
-		bottom_neighbours_coords[0].y = current_coords.y;
-		bottom_neighbours_coords[0].x = current_coords.x;
+void Automata::moveCell(SiteId from, SiteId to) {
+	Cell old_from = _lattice[from], old_to = _lattice[to];
+	_lattice[to] = _lattice[from];
+	_lattice[from].clear();
 
-		bottom_neighbours_coords[1].y = current_coords.y;
-		bottom_neighbours_coords[1].x = more_x;
-	} else if (current_coords.z % 4 == 1) {
-		bottom_neighbours_coords[0].y = current_coords.y;
-		bottom_neighbours_coords[0].x = current_coords.x;
+	changed(from, old_from);
+	changed(to, old_to);
+}
 
-		bottom_neighbours_coords[1].y = more_y;
-		bottom_neighbours_coords[1].x = current_coords.x;
-	} else { // current_coords.z % 4 == 0
-		bottom_neighbours_coords[0].y = current_coords.y;
-		bottom_neighbours_coords[0].x = less_x;
+SiteId Automata::partnerSite(SiteId site) const {
+	int3 direct_n_coords[2];
+	directNeighboursCoords(_lattice.coords(site), direct_n_coords);
+	return _lattice.site(direct_n_coords[_lattice[site].partner()]);
+}
 
-		bottom_neighbours_coords[1].y = current_coords.y;
-		bottom_neighbours_coords[1].x = current_coords.x;
+Automata::DimerState Automata::dimerState(SiteId site, SiteId partner_site) const {
+	const Cell& first = _lattice[site];
+	const Cell& second = _lattice[partner_site];
+	if ((first.active() > 0 && second.hydro() > 0) || (second.active() > 0 && first.hydro() > 0)) {
+		return MIGRATING_DIMER;
 	}
+	return (first.active() > 0 || second.active() > 0) ? ACTIVE_DIMER : HYDRO_DIMER;
+}
+
+void Automata::formDimer(SiteId site, int partner) {
+	int3 direct_n_coords[2];
+	directNeighboursCoords(_lattice.coords(site), direct_n_coords);
+	SiteId partner_site = _lattice.site(direct_n_coords[partner]);
+
+	// узлы попадают в _dimer_bonds при отметке об изменении
+	_lattice[site].bondWith(partner);
+	_lattice[partner_site].bondWith(1 - partner);
+
+	deactivate(site);
+	deactivate(partner_site);
 }
 
-void Automata::torusCoordinate(char coord, int current, int& less, int& more) const {
-	int max;
-	if (coord == 'x') max = _sizes.x - 1;
-	else max = _sizes.y - 1;
+void Automata::deleteDimer(SiteId site1, SiteId site2) {
+	Cell old_cell1 = _lattice[site1], old_cell2 = _lattice[site2];
+	_lattice[site1].unbond();
+	_lattice[site2].unbond();
 
-	less = current - 1;
-	if (less < 0) less = max;
+	changed(site1, old_cell1);
+	changed(site2, old_cell2);
+}
 
-	more = current + 1;
-	if (more > max) more = 0;
+void Automata::Population::clear() {
+	max_z = 0;
+	carbons_num = 0;
+	hydrogen_atoms_num = 0;
+	active_bonds_num = 0;
+	for (int t = 0; t < Cell::TYPES_NUM; ++t) types_num[t] = 0;
+}
+
+void Automata::Population::count(const Cell& cell, int sign) {
+	if (cell.empty()) return;
+	carbons_num += sign;
+	hydrogen_atoms_num += sign * cell.hydro();
+	active_bonds_num += sign * cell.active();
+	types_num[cell.type() - 1] += sign;
+}
+
+void Automata::Population::merge(const Population& other) {
+	if (other.max_z > max_z) max_z = other.max_z;
+	carbons_num += other.carbons_num;
+	hydrogen_atoms_num += other.hydrogen_atoms_num;
+	active_bonds_num += other.active_bonds_num;
+	for (int t = 0; t < Cell::TYPES_NUM; ++t) types_num[t] += other.types_num[t];
+}
+
+void Automata::bottomNeighboursSites(const int3& current_coords, SiteId bottom_neighbours_sites[2]) const {
+	int3 bottom_n_coords[2];
+	bottomNeighboursCoords(current_coords, bottom_n_coords);
+	for (int i = 0; i < 2; ++i) bottom_neighbours_sites[i] = getSite(bottom_n_coords[i]);
 }
 
 }
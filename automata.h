@@ -8,45 +8,200 @@
 #ifndef AUTOMATA_H_
 #define AUTOMATA_H_
 
-#include <map>
+#include <atomic>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "int3.h"
 #include "flags_config.h"
 #include "cell.h"
+#include "change_map.h"
+#include "checkpoint.h"
+#include "checkerboard.h"
+#include "destinations.h"
+#include "indexed_set.h"
+#include "lattice.h"
+#include "profiler.h"
 #include "handbook.h"
+#include "random.h"
+#include "stencil.h"
+#include "thread_pool.h"
+#include "trajectory.h"
 
 namespace DiamondCA {
 
 typedef std::pair<int, int> Range;
-typedef std::set<Cell*> SetOfCells;
-typedef std::map<Cell*, Cell*> CellToCell;
+typedef std::set<SiteId> SetOfSites;
+typedef std::vector<SiteId> VariantSites;
 
 class Outputer;
+class KineticEngine;
+class AutomataBench;
 
 class Automata {
+	friend class KineticEngine;
+	friend class AutomataBench;
+
 public:
 	Automata(const Handbook& handbook, const FlagsConfig& config, Outputer& outputer);
 	virtual ~Automata();
 
+	void seed(uint64_t seed);
+	void setThreads(unsigned int threads_num);
+
 	void stickToCells(const char* mix, const Range& z_range);
 	void stickToCells(const char* mix, const Range& z_range, const Range& y_range);
 	void stickToCells(const char* mix, const Range& z_range, const Range& y_range,
 			const Range& x_range);
+	// начальная поверхность расчёта: первый слой с содержанием initial_spec и три островка
+	void stickInitialCells(const char* initial_spec);
+
+	const int3& sizes() const { return _sizes; }
+	const Lattice& lattice() const { return _lattice; }
 
 	std::string typesArea() const;
+	// то же, что typesArea(), но типами по номерам узлов, для двоичной траектории
+	void areaTypes(AreaTypes& types) const;
 	std::string specsArea() const;
 
-	std::string infoHead() const;
+	// то же по копии состояний узлов решётки (для вывода в фоновом потоке)
+	static void areaTypes(unsigned int volume, const Cell* cells, AreaTypes& types);
+
+	// поверхностная оболочка: занятые узлы со свободными связями или с пустым узлом над ними;
+	// поддерживается при каждом изменении узла, только если включена
+	void trackSurfaceShell();
+	// узлы оболочки по возрастанию номеров и их состояния
+	void surfaceShell(VariantSites& sites, std::vector<Cell>& cells) const;
+
+	// рельеф поверхности: высота каждого столбца (x, y) - наибольший z занятого в нём узла;
+	// средняя высота и шероховатость добавляются в инфо, только если рельеф отслеживается
+	void trackMorphology();
+	// число столбцов каждой высоты и число занятых узлов в каждом слое, от нулевого до max_z
+	void morphology(std::vector<int>& heights_nums, std::vector<int>& layers_carbons) const;
+
+	static std::string infoHead(bool with_morphology = false);
 	std::string infoBody() const;
 
 	void run(float full_time, float out_any_time = 0);
 
+	// во время расчёта снимок состояния сохраняется в file_name раз в period_secs секунд
+	// (0 - только по сигналам SIGUSR1 и SIGTERM)
+	void setCheckpoint(const std::string& file_name, unsigned int period_secs);
+	// расчёт продолжается с сохранённого снимка, будто и не прерывался
+	void restore(const std::string& file_name);
+
+	// замеры процессов (если собрано с PROFILING) пишутся в file_name в конце расчёта
+	// и через каждые write_every выводов (0 - только в конце)
+	void setProfile(const std::string& file_name, unsigned int write_every);
+
+	// отсчёт эпох начинается заново с epoch, кэш назначений и карта изменений сбрасываются
+	// (отсчёт с большого номера позволяет проверить переполнение счётчика эпох)
+	void setEpoch(uint64_t epoch);
+
 private:
-	Automata() { }
+	// у каждого процесса свой независимый поток случайных чисел
+	enum Process {
+		HYDROGEN_MIGRATION,
+		SURFACE_ACTIVATION,
+		SURFACE_DEACTIVATION,
+		METHYL_ADSORPTION,
+		BRIDGE_MIGRATION,
+		DIMERS_FORMING,
+		DIMERS_DROPPING,
+		KINETIC_EVENTS,
+		PROCESSES_NUM
+	};
+
+	// населённость решётки, поддерживаемая при каждом изменении узла
+	struct Population {
+		int max_z;
+		int carbons_num;
+		int hydrogen_atoms_num;
+		int active_bonds_num;
+		int types_num[Cell::TYPES_NUM];
+
+		Population() { clear(); }
+
+		void clear();
+		void count(const Cell& cell, int sign);
+		void merge(const Population& other);
+	};
+
+	// состояние димера по его концам: есть активный конец и водород на другом (водород может
+	// мигрировать), есть только активные концы, нет активных концов
+	enum DimerState {
+		MIGRATING_DIMER,
+		ACTIVE_DIMER,
+		HYDRO_DIMER,
+		DIMER_STATES_NUM
+	};
 
-	void exploreArea();
+	// домен - плитка шахматной раскраски решётки со своими кандидатами и потоками случайных чисел;
+	// домены одного цвета обрабатываются одновременно, результат не зависит от числа потоков.
+	// Число событий процесса считается и округляется по всей решётке, как в однопоточном расчёте,
+	// и делится между доменами (shareEvents()); события разыгрываются в другом порядке, поэтому
+	// траектория с тем же зерном отличается от однопоточной, но статистически с ней совпадает
+	struct Domain {
+		VariantSites sites;
+		VariantSites partners;
+		VariantSites changes;
+		Population population;
+		SetOfSites migrated;
+		Random random[PROCESSES_NUM];
+		int candidates_num;
+		int events_num;
+	};
+
+	typedef void (Automata::*DomainFunc)(Domain& domain);
+
+	// процессы шага идут по доменам, только если расчёт многопоточный и доменов больше одного
+	inline bool byDomains() const {
+		return _pool != 0 && _domains.size() > 1;
+	}
+
+	// включённые процессы и режимы расчёта разрешаются из конфигурации один раз при создании
+	// автомата, дальше проверяются биты, а не строковые ключи
+	enum Feature {
+		WITH_DIMERS_FORM_DROP,
+		WITH_HYDROGEN_MIGRATION,
+		WITH_SURFACE_ACTIVATION,
+		WITH_SURFACE_DEACTIVATION,
+		WITH_METHYL_ADSORPTION,
+		WITH_BRIDGE_MIGRATION,
+		WITH_BRIDGE_MIGRATION_UP_DOWN,
+		WITH_KINETIC,
+		FEATURES_NUM
+	};
+
+	inline bool enabled(Feature feature) const {
+		return (_features & (1u << feature)) != 0;
+	}
+
+	Automata();
+
+	// место, с которого продолжается расчёт: номер шага, а в кинетическом расчёте - время
+	// последнего события и номера следующих выводов
+	struct Progress {
+		Progress() : step(0), time(0), out_index(0), percent_index(0) { }
+		unsigned int step;
+		double time;
+		unsigned int out_index;
+		unsigned int percent_index;
+	};
+
+	void recountSurface();
+	void runSteps(float full_time, float out_any_time);
+	void step();
+	// при переполнении счётчика эпох отсчёт перезапускается с единицы
+	void nextEpoch();
+	void outputStep();
+	// перед каждым выводом погребённые слои без свободных связей сжимаются (см. Lattice::archive())
+	void archiveBuriedLayers();
+
+	// сохраняет снимок, если пришло время или сигнал; возвращает true, если расчёт нужно остановить
+	bool checkpointIfRequested();
+	void saveCheckpoint();
 
 	void migratingHydrogen();
 	void activatingSurface();
@@ -56,48 +211,117 @@ private:
 	void formingDimers();
 	void droppingDimers();
 
-	static SetOfCells* unionCells(const SetOfCells& s1, const SetOfCells& s2);
-	static SetOfCells* differentCells(const SetOfCells& s1, const SetOfCells& s2);
+	void migratingHydrogenIn(Domain& domain);
+	void activatingSurfaceIn(Domain& domain);
+	void deactivatingSurfaceIn(Domain& domain);
+	void addingBridgesIn(Domain& domain);
+	void migratingBridgesIn(Domain& domain);
+	void formingDimersIn(Domain& domain);
+	void droppingDimersIn(Domain& domain);
+
+	void clearDomains();
+	void inDomains(DomainFunc func, bool by_colors);
+	// число событий процесса по всей решётке, округлённое так же, как в однопоточном расчёте,
+	// делится между доменами: событие достаётся домену с вероятностью, пропорциональной числу
+	// его кандидатов (sites), а при is_distinct события приходятся на различных кандидатов
+	void shareEvents(int events_num, bool is_distinct, Random& random);
+	void sumDomains(int& events_num, int* candidates_num = 0) const;
 
-	inline Cell* getCell(const int3& coords) const {
-		return _cells[coords.z][coords.y][coords.x];
+	inline unsigned int domainOf(SiteId site) const {
+		return _checkerboard.tileOf(_lattice.coords(site));
 	}
 
-	inline bool isAvailableForMigrating(Cell* cells[2]) const {
-//		return cells[0] && cells[1] && ((cells[0]->active() > 0 && cells[1]->active() > 0) || isDimer(cells));
-		return cells[0] && cells[1] && isDimer(cells);
+	static bool isBridge(const Cell& cell) {
+		return !cell.empty() && !cell.isDimer() && cell.active() + cell.hydro() > 1;
 	}
 
-	inline bool isAvailableForMigrating(Cell* cell1, Cell* cell2) const {
-		Cell* cells[2] = { cell1, cell2 };
-		return isAvailableForMigrating(cells);
+	// элементарные акты процессов, общие для шагового и кинетического расчёта
+	bool isDimerFormable(SiteId site, int partner);
+	bool isPairFormable(SiteId site);
+	void updateFormablePairs(SiteId site);
+	void dropDimer(SiteId site, SiteId partner_site);
+	void migrateHydrogen(SiteId to_site, SiteId from_site);
+	void formDimerRandomly(SiteId site, Random& random);
+	void adsorbMethyl(SiteId site, SiteId partner_site);
+	void bridgeDestinations(SiteId site, Destinations& destinations);
+	const Destinations& cachedBridgeDestinations(SiteId site, Destinations& buffer);
+	SiteId migrateBridge(SiteId site, const int3& to_coords);
+	SiteId tryMigrateBridge(SiteId site, uint32_t random_word, int& bridges_num);
+
+	// вызывается после каждого изменения состояния узла, old_cell - состояние до изменения
+	void changed(SiteId site, const Cell& old_cell);
+	// приводит принадлежность узла к множествам в соответствие с его состоянием
+	void syncSite(SiteId site);
+	bool isShell(SiteId site) const;
+	void updateShell(SiteId site);
+	void recountMorphology();
+	void updateColumnHeight(SiteId site);
+	void setColumnHeight(unsigned int column, int height);
+
+	inline SiteId getSite(const int3& coords) const {
+		return _lattice.occupied(coords);
+	}
+
+	inline bool isAvailableForMigrating(SiteId sites[2]) const {
+//		return sites[0] != Lattice::NO_SITE && sites[1] != Lattice::NO_SITE
+//				&& ((_lattice[sites[0]].active() > 0 && _lattice[sites[1]].active() > 0) || isDimer(sites));
+		return sites[0] != Lattice::NO_SITE && sites[1] != Lattice::NO_SITE && isDimer(sites);
+	}
+
+	inline bool isAvailableForMigrating(SiteId site1, SiteId site2) const {
+		SiteId sites[2] = { site1, site2 };
+		return isAvailableForMigrating(sites);
+	}
+
+	inline bool isDimer(SiteId sites[2]) const {
+		return _lattice[sites[0]].isDimer() && _lattice[sites[1]].isDimer() && partnerSite(sites[0]) == sites[1];
 	}
 
-	inline bool isDimer(Cell* cells[2]) const {
-		return _dimers.count(cells[0]) > 0 && _dimers.count(cells[1]) > 0
-				&& ((_dimer_bonds.count(cells[0]) > 0 && _dimer_bonds.find(cells[0])->second == cells[1])
-						|| (_dimer_bonds.count(cells[1]) > 0 && _dimer_bonds.find(cells[1])->second == cells[0]));
+	SiteId partnerSite(SiteId site) const;
+	DimerState dimerState(SiteId site, SiteId partner_site) const;
+
+	// димеры, на которые может сесть метил-радикал: объединение двух корзин
+	inline unsigned int activeDimersNum() const {
+		return _dimers[MIGRATING_DIMER].size() + _dimers[ACTIVE_DIMER].size();
+	}
+	inline SiteId activeDimer(unsigned int index) const {
+		unsigned int migrating_num = _dimers[MIGRATING_DIMER].size();
+		return (index < migrating_num) ? _dimers[MIGRATING_DIMER][index] : _dimers[ACTIVE_DIMER][index - migrating_num];
 	}
 
-	bool isCanDirectMigrating(Cell* cell, const int3& to_coords);
+	bool isCanDirectMigrating(SiteId site, const int3& to_coords);
 
-	void activate(Cell* cell);
-	void deactivate(Cell* cell);
-	void formDimerPart(Cell* cell);
-	void deleteDimer(Cell* cell1, Cell* cell2);
-	static void topNeighbourCoords(const int3& coords1, const int3& coords2, int3& top_neighbour_coords);
-	void directNeighboursCoords(const int3& current_coords, int3 direct_neighbours_coords[2]) const;
-	void flatNeighboursCoords(const int3& current_coords, int3 flat_neighbours_coords[2][2]) const;
-	void bottomNeighboursCells(const int3& current_coords, Cell* bottom_neighbours_cells[2]) const;
-	void bottomNeighboursCoords(const int3& current_coords, int3 bottom_neighbours_coords[2]) const;
-	void torusCoordinate(char coord, int current, int& less, int& more) const;
+	void activate(SiteId site);
+	void deactivate(SiteId site);
+	void addHydrogen(SiteId site);
+	void removeHydrogen(SiteId site);
+	void moveCell(SiteId from, SiteId to);
+	void formDimer(SiteId site, int partner);
+	void deleteDimer(SiteId site1, SiteId site2);
+
+	// соседи берутся из таблиц смещений по классу слоя
+	inline void topNeighbourCoords(const int3& coords1, const int3& coords2, int3& top_neighbour_coords) const {
+		top_neighbour_coords = _stencil.top(coords1, coords2);
+	}
+	inline void directNeighboursCoords(const int3& current_coords, int3 direct_neighbours_coords[2]) const {
+		_stencil.direct(current_coords, direct_neighbours_coords);
+	}
+	inline void flatNeighboursCoords(const int3& current_coords, int3 flat_neighbours_coords[2][2]) const {
+		_stencil.flat(current_coords, flat_neighbours_coords);
+	}
+	void bottomNeighboursSites(const int3& current_coords, SiteId bottom_neighbours_sites[2]) const;
+	inline void bottomNeighboursCoords(const int3& current_coords, int3 bottom_neighbours_coords[2]) const {
+		_stencil.bottom(current_coords, bottom_neighbours_coords);
+	}
 
 private:
-	FlagsConfig _config;
+	unsigned int _features;
+	const Handbook* _handbook;
 	Outputer* _outputer;
 
 	int3 _sizes;
-	Cell**** _cells;
+	Lattice _lattice;
+	Stencil _stencil;
 
 	float _dt;
 	double _k_abs_H_dt;
@@ -106,18 +330,68 @@ private:
 	double _k_migrate_H_dt;
 	double _percent_of_not_dimers;
 
-	CellToCell _dimer_bonds;
+	// по одному узлу от каждого димера, партнёр хранится в состоянии узла
+	IndexedSet _dimer_bonds;
+	// те же узлы, разложенные по состоянию концов димера
+	IndexedSet _dimers[DIMER_STATES_NUM];
+
+	IndexedSet _actives;
+	IndexedSet _hydrides;
+
+	// узлы, образующие со своим бо́льшим прямым соседом пару, готовую стать димером
+	// (оба активны, оба не в димерах, над парой пусто)
+	IndexedSet _formable_pairs;
+
+	bool _is_shell_tracked;
+	IndexedSet _shell;
+
+	// высоты столбцов обновляются при синхронизации узлов, а вместе с ними - число столбцов
+	// каждой высоты и суммы высот и их квадратов; число узлов в слоях меняется прямо
+	// при изменении узла, в том числе из потоков доменов
+	bool _is_morphology_tracked;
+	std::vector<int> _column_heights;
+	std::vector<int> _heights_nums;
+	long long _heights_sum;
+	long long _heights_squares_sum;
+	std::atomic<int>* _layers_carbons;
+
+	// мостовые группы и кэш их назначений миграции (в порядке _bridges); назначения действительны,
+	// пока рядом с группой ничего не менялось начиная с эпохи, в которую они вычислены
+	struct CachedDestinations {
+		CachedDestinations() : epoch(0) { }
+		uint64_t epoch;
+		Destinations coords;
+	};
+
+	IndexedSet _bridges;
+	std::vector<CachedDestinations> _bridges_destinations;
+	ChangeMap _changes;
+	// эпоха растёт перед каждым процессом шага и перед каждым событием кинетического расчёта
+	// (см. nextEpoch()); нулевая эпоха означает, что назначения ещё не вычислены
+	uint64_t _epoch;
+
+	Random _random[PROCESSES_NUM];
+
+	Progress _progress;
+	Profiler _profiler;
+	std::string _checkpoint_file_name;
+	CheckpointSchedule _checkpoint_schedule;
+
+	Checkerboard _checkerboard;
+	ThreadPool* _pool;
+	std::vector<Domain> _domains;
+	SetOfSites _migrated_sites;
+
+	// домен, обрабатываемый текущим потоком: изменения узлов не синхронизируются с множествами
+	// сразу, а складываются в его журнал; синхронизация выполняется затем в одном потоке
+	static thread_local Domain* _deferred_domain;
 
-	SetOfCells _dimers;
-	SetOfCells _actives;
-	SetOfCells _hydrides;
+	// если задан, сюда складываются все изменённые узлы (для пересчёта скоростей)
+	VariantSites* _touched_sites;
 
 	float _time;
-	int _max_z;
-	int _carbons_num;
-	int _hydrogen_atoms_num;
+	Population _population;
 	int _active_dimers_num;
-	int _active_bonds_num;
 //	int _active_bridges_num;
 	int _bridges_num;
 	int _abstracted_hydrogen_atoms_num;
@@ -5,19 +5,14 @@
  *      Author: newmen
  */
 
-#include <sstream>
-
 #include "cell.h"
 
 namespace DiamondCA {
 
-Cell::Cell(const char* mix, int z, int y, int x) : _coords(z, y, x) {
-	compose(mix);
-}
-
 void Cell::compose(const char* mix) {
-	_active = Cell::parse_mix(mix, '*');
-	_hydro = Cell::parse_mix(mix, 'H');
+	_state = OCCUPIED_BIT;
+	setActive(Cell::parse_mix(mix, '*'));
+	setHydro(Cell::parse_mix(mix, 'H'));
 }
 
 int Cell::parse_mix(const char* mix, char spec) {
@@ -30,34 +25,24 @@ int Cell::parse_mix(const char* mix, char spec) {
 }
 
 int Cell::type() const {
+	int a = active(), h = hydro();
 	int t;
-	if (_active == 0 && _hydro == 0) t = 1;
-	else if (_active == 1 && _hydro == 0) t = 2;
-	else if (_active == 0 && _hydro == 1) t = 3;
-	else if (_active == 2 && _hydro == 0) t = 4;
-	else if (_active == 1 && _hydro == 1) t = 5;
-	else if (_active == 0 && _hydro == 2) t = 6;
+	if (a == 0 && h == 0) t = 1;
+	else if (a == 1 && h == 0) t = 2;
+	else if (a == 0 && h == 1) t = 3;
+	else if (a == 2 && h == 0) t = 4;
+	else if (a == 1 && h == 1) t = 5;
+	else if (a == 0 && h == 2) t = 6;
 	else t = 7;
 
 	return t;
 }
 
-std::string Cell::spec() const {
-	int ckey = cache_key();
-	if (Cell::cache_of_specs.count(ckey) > 0) return Cell::cache_of_specs[ckey];
-
-	std::stringstream ss;
-	for (int i = 0; i < _active; ++i) ss << '*';
-	ss << 'C';
-	if (_hydro > 0) {
-		ss << 'H';
-		if (_hydro > 1) ss << _hydro;
-	}
-
-	Cell::cache_of_specs[ckey] = ss.str();
-	return Cell::cache_of_specs[ckey];
-}
-
-std::map< int, std::string > Cell::cache_of_specs = std::map< int, std::string >();
+const char* const Cell::SPECS[4][4] = {
+	{ "C", "CH", "CH2", "CH3" },
+	{ "*C", "*CH", "*CH2", "*CH3" },
+	{ "**C", "**CH", "**CH2", "**CH3" },
+	{ "***C", "***CH", "***CH2", "***CH3" }
+};
 
 }
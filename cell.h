@@ -8,52 +8,78 @@
 #ifndef CELL_H_
 #define CELL_H_
 
-#include <map>
-#include <string>
-
-#include "int3.h"
+#include <cassert>
 
 namespace DiamondCA {
 
+// Состояние узла решётки, упакованное в один байт:
+// биты 0-1 - число активных связей, биты 2-3 - число атомов водорода,
+// биты 4-5 - направление на партнёра по димеру (0 - нет димера, 1 - меньший прямой сосед, 2 - больший),
+// бит 7 - узел занят углеродом
 class Cell {
 public:
-	Cell(const char* mix, int z, int y, int x);
-	virtual ~Cell() { }
+	// типы узлов, возвращаемые type(), нумеруются с единицы
+	enum { TYPES_NUM = 7 };
+
+	Cell() : _state(0) { }
+	Cell(const char* mix) : _state(0) { compose(mix); }
 
 	void compose(const char* mix);
+	void clear() { _state = 0; }
 
-	int active() const { return _active; }
-	int hydro() const { return _hydro; }
-	int3 coords() const { return _coords; }
-	void setCoords(const int3& coords) { _coords = coords; }
+	bool empty() const { return (_state & OCCUPIED_BIT) == 0; }
+	int active() const { return _state & ACTIVE_MASK; }
+	int hydro() const { return (_state & HYDRO_MASK) >> HYDRO_SHIFT; }
+
+	bool isDimer() const { return (_state & PARTNER_MASK) != 0; }
+	// индекс партнёра по димеру в массиве прямых соседей (0 или 1), -1 если узел не в димере
+	int partner() const { return ((_state & PARTNER_MASK) >> PARTNER_SHIFT) - 1; }
+	void bondWith(int partner) {
+		_state = (_state & ~PARTNER_MASK) | (((partner + 1) << PARTNER_SHIFT) & PARTNER_MASK);
+	}
+	void unbond() { _state &= ~PARTNER_MASK; }
 
-	void activate() { ++_active; }
-	void deactivate() { --_active; }
+	void activate() { setActive(active() + 1); }
+	void deactivate() { setActive(active() - 1); }
 	void addHydrogen() {
 		deactivate();
-		++_hydro;
+		setHydro(hydro() + 1);
 	}
 	void removeHydrogen() {
 		activate();
-		--_hydro;
+		setHydro(hydro() - 1);
 	}
 
 	int type() const;
-	std::string spec() const;
+	// вид узла ("*C", "CH2" и т.п.) из таблицы по числу активных связей и атомов водорода
+	const char* spec() const { return SPECS[active()][hydro()]; }
 
 private:
-	Cell() { }
-
-	int cache_key() const { return 10 * _active + _hydro; }
+	enum {
+		ACTIVE_MASK = 0x03,
+		HYDRO_SHIFT = 2,
+		HYDRO_MASK = 0x0c,
+		PARTNER_SHIFT = 4,
+		PARTNER_MASK = 0x30,
+		OCCUPIED_BIT = 0x80
+	};
+
+	// в двух битах помещается 0..3, выход за пределы означает ошибку в правилах автомата
+	void setActive(int active) {
+		assert(0 <= active && active <= 3);
+		_state = (_state & ~ACTIVE_MASK) | (active & ACTIVE_MASK);
+	}
+	void setHydro(int hydro) {
+		assert(0 <= hydro && hydro <= 3);
+		_state = (_state & ~HYDRO_MASK) | ((hydro << HYDRO_SHIFT) & HYDRO_MASK);
+	}
 
 	static int parse_mix(const char* mix, char spec);
 
 private:
-	int _active;
-	int _hydro;
-	int3 _coords;
+	unsigned char _state;
 
-	static std::map< int, std::string > cache_of_specs;
+	static const char* const SPECS[4][4];
 };
 
 }
@@ -0,0 +1,56 @@
+/*
+ * change_map.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "change_map.h"
+
+namespace DiamondCA {
+
+ChangeMap::ChangeMap(const int3& sizes) : _sizes(sizes) {
+	int block_size = 1 << BLOCK_BITS;
+	_blocks_x = (sizes.x + block_size - 1) / block_size;
+	int blocks_num = _blocks_x * ((sizes.y + block_size - 1) / block_size);
+
+	_blocks_num = blocks_num;
+	_stamps = new std::atomic<uint64_t>[blocks_num];
+	clear();
+}
+
+ChangeMap::~ChangeMap() {
+	delete[] _stamps;
+}
+
+void ChangeMap::clear() {
+	for (int i = 0; i < _blocks_num; ++i) _stamps[i].store(0, std::memory_order_relaxed);
+}
+
+uint64_t ChangeMap::latestAround(const int3& coords, int radius) const {
+	int ys[8], xs[8];
+	int ys_num = blocksAlong(coords.y, radius, _sizes.y, ys);
+	int xs_num = blocksAlong(coords.x, radius, _sizes.x, xs);
+
+	uint64_t latest = 0;
+	for (int iy = 0; iy < ys_num; ++iy) {
+		for (int ix = 0; ix < xs_num; ++ix) {
+			uint64_t stamp = _stamps[ys[iy] * _blocks_x + xs[ix]].load(std::memory_order_relaxed);
+			if (stamp > latest) latest = stamp;
+		}
+	}
+	return latest;
+}
+
+// номера блоков, задевающих отрезок [coord - radius, coord + radius] на торе (radius < 4)
+int ChangeMap::blocksAlong(int coord, int radius, int size, int blocks[]) {
+	int blocks_num = 0;
+	for (int d = -radius; d <= radius; ++d) {
+		int block = ((coord + d + size) % size) >> BLOCK_BITS;
+		if (blocks_num > 0 && blocks[blocks_num - 1] == block) continue;
+		blocks[blocks_num++] = block;
+	}
+	return blocks_num;
+}
+
+}
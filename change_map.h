@@ -0,0 +1,60 @@
+/*
+ * change_map.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef CHANGE_MAP_H_
+#define CHANGE_MAP_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "int3.h"
+
+namespace DiamondCA {
+
+// Грубая карта изменений решётки: плоскость X-Y разбита на блоки столбцов, и для каждого блока
+// хранится метка (номер эпохи) последнего изменения любого узла в нём. По ней можно быстро
+// узнать, менялось ли что-нибудь рядом с узлом после заданной эпохи. Метки 64-битные, так что
+// за время расчёта счётчик эпох не переполняется.
+// Метки атомарны, поэтому отмечать изменения можно из нескольких потоков одновременно.
+class ChangeMap {
+public:
+	ChangeMap(const int3& sizes);
+	virtual ~ChangeMap();
+
+	void mark(const int3& coords, uint64_t stamp) {
+		_stamps[blockIndex(coords.y, coords.x)].store(stamp, std::memory_order_relaxed);
+	}
+
+	// наибольшая метка среди блоков, задевающих квадрат со стороной 2 * radius + 1 вокруг узла
+	uint64_t latestAround(const int3& coords, int radius) const;
+
+	// все метки обнуляются (при перезапуске отсчёта эпох)
+	void clear();
+
+private:
+	enum { BLOCK_BITS = 2 };
+
+	ChangeMap();
+	ChangeMap(const ChangeMap&);
+	ChangeMap& operator=(const ChangeMap&);
+
+	int blockIndex(int y, int x) const {
+		return (y >> BLOCK_BITS) * _blocks_x + (x >> BLOCK_BITS);
+	}
+
+	static int blocksAlong(int coord, int radius, int size, int blocks[]);
+
+private:
+	int3 _sizes;
+	int _blocks_x;
+	int _blocks_num;
+	std::atomic<uint64_t>* _stamps;
+};
+
+}
+
+#endif /* CHANGE_MAP_H_ */
@@ -0,0 +1,34 @@
+/*
+ * checkerboard.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "checkerboard.h"
+
+namespace DiamondCA {
+
+Checkerboard::Checkerboard(const int3& sizes, int min_tile_size) {
+	_tiles_x = tilesAlong(sizes.x, min_tile_size);
+	_tiles_y = tilesAlong(sizes.y, min_tile_size);
+	_tile_x = sizes.x / _tiles_x;
+	_tile_y = sizes.y / _tiles_y;
+
+	for (int ty = 0; ty < _tiles_y; ++ty) {
+		for (int tx = 0; tx < _tiles_x; ++tx) {
+			_colors[(tx % 2) + 2 * (ty % 2)].push_back(ty * _tiles_x + tx);
+			_all.push_back(ty * _tiles_x + tx);
+		}
+	}
+}
+
+int Checkerboard::tilesAlong(int size, int min_tile_size) {
+	// на торе раскраска через одну плитку возможна только при чётном числе плиток,
+	// лишняя плитка сливается с предпоследней
+	int tiles_num = size / min_tile_size;
+	if (tiles_num < 2) return 1;
+	return tiles_num - tiles_num % 2;
+}
+
+}
@@ -0,0 +1,56 @@
+/*
+ * checkerboard.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef CHECKERBOARD_H_
+#define CHECKERBOARD_H_
+
+#include <vector>
+
+#include "int3.h"
+
+namespace DiamondCA {
+
+typedef std::vector<unsigned int> TilesList;
+
+// Разбиение плоскости X-Y (тора) на прямоугольные плитки, раскрашенные в четыре цвета так,
+// что между любыми двумя плитками одного цвета лежит целая плитка другого цвета.
+// Если размер плитки не меньше радиуса влияния события, плитки одного цвета можно
+// обрабатывать одновременно.
+class Checkerboard {
+public:
+	enum { COLORS_NUM = 4 };
+
+	Checkerboard(const int3& sizes, int min_tile_size);
+	virtual ~Checkerboard() { }
+
+	unsigned int tilesNum() const { return _tiles_x * _tiles_y; }
+	const TilesList& tilesOfColor(int color) const { return _colors[color]; }
+	const TilesList& allTiles() const { return _all; }
+
+	unsigned int tileOf(const int3& coords) const {
+		return tileIndex(coords.y, _tile_y, _tiles_y) * _tiles_x + tileIndex(coords.x, _tile_x, _tiles_x);
+	}
+
+private:
+	Checkerboard();
+
+	static int tilesAlong(int size, int min_tile_size);
+	static unsigned int tileIndex(int coord, int tile_size, int tiles_num) {
+		int index = coord / tile_size;
+		return (index < tiles_num) ? index : tiles_num - 1;
+	}
+
+private:
+	int _tiles_x, _tiles_y;
+	int _tile_x, _tile_y;
+	TilesList _colors[COLORS_NUM];
+	TilesList _all;
+};
+
+}
+
+#endif /* CHECKERBOARD_H_ */
@@ -0,0 +1,118 @@
+/*
+ * checkpoint.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "checkpoint_error.h"
+
+namespace DiamondCA {
+
+CheckpointWriter::CheckpointWriter(const std::string& file_name) :
+		_file_name(file_name), _tmp_file_name(file_name + ".tmp")
+{
+	_file = fopen(_tmp_file_name.c_str(), "wb");
+	if (!_file) throw CheckpointError("Cannot create checkpoint file " + _tmp_file_name);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	// незавершённый снимок удаляется, предыдущий остаётся нетронутым
+	if (_file) {
+		fclose(_file);
+		remove(_tmp_file_name.c_str());
+	}
+}
+
+void CheckpointWriter::write(const void* data, size_t size) {
+	if (size > 0 && fwrite(data, 1, size, _file) != size) {
+		throw CheckpointError("Cannot write checkpoint file " + _tmp_file_name);
+	}
+}
+
+void CheckpointWriter::commit() {
+	bool is_written = (fflush(_file) == 0 && fsync(fileno(_file)) == 0);
+	is_written = (fclose(_file) == 0) && is_written;
+	_file = 0;
+
+	if (!is_written || rename(_tmp_file_name.c_str(), _file_name.c_str()) != 0) {
+		remove(_tmp_file_name.c_str());
+		throw CheckpointError("Cannot save checkpoint file " + _file_name);
+	}
+}
+
+CheckpointReader::CheckpointReader(const std::string& file_name) :
+		_file_name(file_name), _data(0), _size(0), _offset(0)
+{
+	int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0) throw CheckpointError("Cannot open checkpoint file " + file_name);
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		throw CheckpointError("Checkpoint file " + file_name + " is empty");
+	}
+	_size = info.st_size;
+
+	void* data = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) throw CheckpointError("Cannot map checkpoint file " + file_name);
+	// файл читается один раз от начала до конца
+	madvise(data, _size, MADV_SEQUENTIAL);
+	_data = (const char*)data;
+}
+
+CheckpointReader::~CheckpointReader() {
+	if (_data) munmap((void*)_data, _size);
+}
+
+const void* CheckpointReader::read(size_t size) {
+	if (size > _size - _offset) throw CheckpointError("Checkpoint file " + _file_name + " is truncated");
+
+	const void* result = _data + _offset;
+	_offset += size;
+	return result;
+}
+
+static volatile sig_atomic_t save_requested = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+extern "C" void onCheckpointSignal(int signal_number) {
+	if (signal_number == SIGTERM) stop_requested = 1;
+	save_requested = 1;
+}
+
+void CheckpointSchedule::start(unsigned int period_secs) {
+	_period = period_secs;
+	_last_time = time(0);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onCheckpointSignal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &action, 0);
+	sigaction(SIGTERM, &action, 0);
+}
+
+CheckpointSchedule::Request CheckpointSchedule::poll() {
+	Request request = NO_REQUEST;
+	if (save_requested) {
+		save_requested = 0;
+		request = stop_requested ? SAVE_AND_STOP : SAVE;
+	} else if (_period > 0 && time(0) - _last_time >= _period) {
+		request = SAVE;
+	}
+
+	if (request != NO_REQUEST) _last_time = time(0);
+	return request;
+}
+
+}
@@ -0,0 +1,97 @@
+/*
+ * checkpoint.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace DiamondCA {
+
+// Запись двоичного снимка состояния расчёта. Снимок пишется во временный файл рядом с целевым
+// и переименовывается только после полной записи, поэтому прерванная запись не портит
+// предыдущий снимок.
+class CheckpointWriter {
+public:
+	CheckpointWriter(const std::string& file_name);
+	virtual ~CheckpointWriter();
+
+	void write(const void* data, size_t size);
+	template <typename T>
+	void write(const T& value) { write(&value, sizeof(T)); }
+
+	void commit();
+
+private:
+	CheckpointWriter();
+	CheckpointWriter(const CheckpointWriter&);
+	CheckpointWriter& operator=(const CheckpointWriter&);
+
+private:
+	std::string _file_name;
+	std::string _tmp_file_name;
+	FILE* _file;
+};
+
+// Чтение снимка: файл отображается в память целиком, большие блоки (решётка, множества)
+// копируются из отображения без промежуточных буферов.
+class CheckpointReader {
+public:
+	CheckpointReader(const std::string& file_name);
+	virtual ~CheckpointReader();
+
+	const void* read(size_t size);
+	void read(void* data, size_t size) { memcpy(data, read(size), size); }
+	template <typename T>
+	T read() {
+		T value;
+		read(&value, sizeof(T));
+		return value;
+	}
+
+	bool atEnd() const { return _offset == _size; }
+
+private:
+	CheckpointReader();
+	CheckpointReader(const CheckpointReader&);
+	CheckpointReader& operator=(const CheckpointReader&);
+
+private:
+	std::string _file_name;
+	const char* _data;
+	size_t _size;
+	size_t _offset;
+};
+
+// Когда сохранять снимок: раз в заданное число секунд реального времени, а также по сигналам
+// SIGUSR1 (снимок, и расчёт продолжается) и SIGTERM (снимок, и расчёт останавливается)
+class CheckpointSchedule {
+public:
+	enum Request {
+		NO_REQUEST,
+		SAVE,
+		SAVE_AND_STOP
+	};
+
+	CheckpointSchedule() : _period(0), _last_time(0) { }
+	virtual ~CheckpointSchedule() { }
+
+	void start(unsigned int period_secs);
+
+	Request poll();
+
+private:
+	time_t _period;
+	time_t _last_time;
+};
+
+}
+
+#endif /* CHECKPOINT_H_ */
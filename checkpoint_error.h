@@ -0,0 +1,31 @@
+/*
+ * checkpoint_error.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef CHECKPOINT_ERROR_H_
+#define CHECKPOINT_ERROR_H_
+
+#include <string>
+
+namespace DiamondCA {
+
+class CheckpointError {
+public:
+	CheckpointError(const std::string& message) : _message(message) { }
+	virtual ~CheckpointError() { }
+
+	virtual std::string getMessage() const { return _message; }
+
+private:
+	CheckpointError() { }
+
+private:
+	std::string _message;
+};
+
+}
+
+#endif /* CHECKPOINT_ERROR_H_ */
@@ -6,18 +6,24 @@
  */
 
 #include <boost/regex.hpp>
+#include <cstdlib>
+#include <ctime>
 #include <sstream>
 
 #include "configurator.h"
 #include "parse_error.h"
 #include "parse_params_error.h"
+#include "profiler.h"
 
 namespace DiamondCA {
 
 Configurator::Configurator() : _need_help(false), _config_file_name(CONFIG_FILE),
 		_initial_spec(INITIAL_SPEC),
 //		_steps(STEPS), _any_step(ANY_STEP),
-		_full_time(FULL_TIME), _any_time(ANY_TIME),
+		_full_time(FULL_TIME), _any_time(ANY_TIME), _seed(time(0)), _threads(1),
+		_checkpoint_file_name(""), _checkpoint_time(CHECKPOINT_TIME), _restart_file_name(""),
+		_profile_file_name(""), _profile_every(0),
+		_ensemble_size(0), _trajectory_file_name(""),
 		_prefix("")
 {
 	_automata_config["dimers-form-drop"] = true;
@@ -27,6 +33,7 @@ Configurator::Configurator() : _need_help(false), _config_file_name(CONFIG_FILE)
 	_automata_config["methyl-adsorption"] = true;
 	_automata_config["bridge-migration"] = true;
 	_automata_config["bridge-migration-up-down"] = true;
+	_automata_config["kinetic"] = false;
 
 	_outputer_config["only-info"] = false;
 	_outputer_config["only-specs"] = false;
@@ -34,6 +41,11 @@ Configurator::Configurator() : _need_help(false), _config_file_name(CONFIG_FILE)
 	_outputer_config["without-area"] = false;
 	_outputer_config["without-info"] = false;
 	_outputer_config["with-specs"] = false;
+	_outputer_config["binary-area"] = false;
+	_outputer_config["async-output"] = false;
+	_outputer_config["surface-area"] = false;
+	_outputer_config["height-map"] = false;
+	_outputer_config["morphology"] = false;
 }
 
 void Configurator::parseParams(int argc, char* argv[]) {
@@ -49,6 +61,15 @@ void Configurator::parseParams(int argc, char* argv[]) {
 //	boost::regex rx_any_step("(-as|--any-step)=(\\d+)");
 	boost::regex rx_ft("(-ft|--full-time)=([\\d\\.]+)");
 	boost::regex rx_at("(-at|--any-time)=([\\d\\.]+)");
+	boost::regex rx_seed("(-sd|--seed)=(\\d+)");
+	boost::regex rx_threads("(-th|--threads)=(\\d+)");
+	boost::regex rx_checkpoint("(-cp|--checkpoint)=([\\/\\w\\._-]+)");
+	boost::regex rx_checkpoint_time("(-cpt|--checkpoint-time)=(\\d+)");
+	boost::regex rx_restart("(-rs|--restart)=([\\/\\w\\._-]+)");
+	boost::regex rx_profile("(-pf|--profile)=([\\/\\w\\._-]+)");
+	boost::regex rx_profile_every("(-pfe|--profile-every)=(\\d+)");
+	boost::regex rx_ensemble("(-en|--ensemble)=(\\d+)");
+	boost::regex rx_temperature_grid("(-tg|--temperature-grid)=([\\d\\.]+(,[\\d\\.]+)*)");
 	boost::regex rx_wo_dfd("-wo-dfd|--without-dimers-form-drop");
 	boost::regex rx_wo_hm("-wo-hm|--without-hydrogen-migration");
 	boost::regex rx_wo_as("-wo-as|--without-activate-surface");
@@ -56,12 +77,19 @@ void Configurator::parseParams(int argc, char* argv[]) {
 	boost::regex rx_wo_ma("-wo-ma|--without-methyl-adsorption");
 	boost::regex rx_wo_bm("-wo-bm|--without-bridge-migration");
 	boost::regex rx_wo_bm_ud("-wo-bm-ud|--without-bridge-migration-up-down");
+	boost::regex rx_kmc("-kmc|--kinetic");
 	boost::regex rx_oi("-oi|--only-info");
 	boost::regex rx_os("-os|--only-specs");
 	boost::regex rx_cob("-cob|--clear-output-buffers");
 	boost::regex rx_wo_a("-wo-a|--without-area");
 	boost::regex rx_wo_i("-wo-i|--without-info");
 	boost::regex rx_w_s("-w-s|--with-specs");
+	boost::regex rx_b_a("-ba|--binary-area");
+	boost::regex rx_ao("-ao|--async-output");
+	boost::regex rx_sa("-sa|--surface-area");
+	boost::regex rx_hm("-hm|--height-map");
+	boost::regex rx_mo("-mo|--morphology");
+	boost::regex rx_convert("(-ct|--convert-trajectory)=([\\/\\w\\._-]+)");
 	boost::regex rx_migration_test("--migration-test");
 	boost::regex rx_prefix("^([^-][\\S]*)$");
 
@@ -79,6 +107,20 @@ void Configurator::parseParams(int argc, char* argv[]) {
 //		else if (boost::regex_match(current_param, matches, rx_any_step)) _any_step = atoi(matches[2].str().c_str());
 		else if (boost::regex_match(current_param, matches, rx_ft)) _full_time = atof(matches[2].str().c_str());
 		else if (boost::regex_match(current_param, matches, rx_at)) _any_time = atof(matches[2].str().c_str());
+		else if (boost::regex_match(current_param, matches, rx_seed)) _seed = strtoull(matches[2].str().c_str(), 0, 10);
+		else if (boost::regex_match(current_param, matches, rx_threads)) _threads = atoi(matches[2].str().c_str());
+		else if (boost::regex_match(current_param, matches, rx_checkpoint)) _checkpoint_file_name = matches[2];
+		else if (boost::regex_match(current_param, matches, rx_checkpoint_time)) _checkpoint_time = atoi(matches[2].str().c_str());
+		else if (boost::regex_match(current_param, matches, rx_restart)) _restart_file_name = matches[2];
+		else if (boost::regex_match(current_param, matches, rx_profile)) _profile_file_name = matches[2];
+		else if (boost::regex_match(current_param, matches, rx_profile_every)) _profile_every = atoi(matches[2].str().c_str());
+		else if (boost::regex_match(current_param, matches, rx_ensemble)) _ensemble_size = atoi(matches[2].str().c_str());
+		else if (boost::regex_match(current_param, matches, rx_temperature_grid)) {
+			std::stringstream grid(matches[2]);
+			std::string temperature;
+			_temperature_grid.clear();
+			while (std::getline(grid, temperature, ',')) _temperature_grid.push_back(atof(temperature.c_str()));
+		}
 		else if (boost::regex_match(current_param, matches, rx_wo_dfd)) _automata_config["dimers-form-drop"] = false;
 		else if (boost::regex_match(current_param, matches, rx_wo_hm)) _automata_config["hydrogen-migration"] = false;
 		else if (boost::regex_match(current_param, matches, rx_wo_as)) _automata_config["activate-surface"] = false;
@@ -86,16 +128,36 @@ void Configurator::parseParams(int argc, char* argv[]) {
 		else if (boost::regex_match(current_param, matches, rx_wo_ma)) _automata_config["methyl-adsorption"] = false;
 		else if (boost::regex_match(current_param, matches, rx_wo_bm)) _automata_config["bridge-migration"] = false;
 		else if (boost::regex_match(current_param, matches, rx_wo_bm_ud)) _automata_config["bridge-migration-up-down"] = false;
+		else if (boost::regex_match(current_param, matches, rx_kmc)) _automata_config["kinetic"] = true;
 		else if (boost::regex_match(current_param, matches, rx_oi)) _outputer_config["only-info"] = true;
 		else if (boost::regex_match(current_param, matches, rx_os)) _outputer_config["only-specs"] = true;
 		else if (boost::regex_match(current_param, matches, rx_cob)) _outputer_config["clear-output-buffers"] = true;
 		else if (boost::regex_match(current_param, matches, rx_wo_a)) _outputer_config["without-area"] = true;
 		else if (boost::regex_match(current_param, matches, rx_wo_i)) _outputer_config["without-info"] = true;
 		else if (boost::regex_match(current_param, matches, rx_w_s)) _outputer_config["with-specs"] = true;
+		else if (boost::regex_match(current_param, matches, rx_b_a)) _outputer_config["binary-area"] = true;
+		else if (boost::regex_match(current_param, matches, rx_ao)) _outputer_config["async-output"] = true;
+		else if (boost::regex_match(current_param, matches, rx_sa)) _outputer_config["surface-area"] = true;
+		else if (boost::regex_match(current_param, matches, rx_hm)) _outputer_config["height-map"] = true;
+		else if (boost::regex_match(current_param, matches, rx_mo)) _outputer_config["morphology"] = true;
+		else if (boost::regex_match(current_param, matches, rx_convert)) _trajectory_file_name = matches[2];
 		else if (i == argc - 1 && boost::regex_match(current_param, matches, rx_prefix)) _prefix = matches[1];
 		else throw ParseParamsError("Undefined parameter", current_param);
 	}
 
+	if (_threads == 0) throw ParseError("Number of threads (-th, --threads) must be positive");
+
+	if (_profile_file_name != "" && !Profiler::isCompiled()) {
+		throw ParseError("Profiling (-pf, --profile) requires the program built with PROFILING (make PROFILE=1)");
+	}
+
+	if (_ensemble_size == 0 && !_temperature_grid.empty()) {
+		throw ParseError("Temperature grid (-tg, --temperature-grid) is used only with -en (--ensemble)");
+	}
+	if (_ensemble_size > 0 && (_checkpoint_file_name != "" || _restart_file_name != "")) {
+		throw ParseError("Cannot use -en (--ensemble) with checkpoints (-cp, -rs)");
+	}
+
 	if (_outputer_config["only-info"] && _outputer_config["only-specs"]) {
 		throw ParseError("Cannot use -oi (--only-info) with -os (--only-specs)");
 	}
@@ -131,6 +193,31 @@ std::string Configurator::help() const {
 			<< _full_time << ")\n"
 			<< "  -at=число, --any-time=число - вывод результатов, когда время кратно этому значению секунд (по умолчанию "
 			<< _any_time << ")\n"
+			<< "  -sd=число, --seed=число - зерно генератора случайных чисел, при одинаковом зерне расчёт "
+			<< "повторяется в точности (по умолчанию текущее время)\n"
+			<< "  -th=число, --threads=число - число потоков расчёта (по умолчанию " << _threads << "), "
+			<< "при двух и более потоках решётка делится на домены, и результат при одинаковом зерне "
+			<< "не зависит от числа потоков, а от однопоточного отличается только траекторией, "
+			<< "но не статистикой\n"
+			<< "\n"
+			<< "  -cp=файл, --checkpoint=файл - сохранять в файл двоичный снимок состояния расчёта: "
+			<< "периодически, по сигналу SIGUSR1 (расчёт продолжается) и по сигналу SIGTERM (расчёт останавливается)\n"
+			<< "  -cpt=число, --checkpoint-time=число - период сохранения снимка в секундах реального времени, "
+			<< "0 - только по сигналам (по умолчанию " << _checkpoint_time << ")\n"
+			<< "  -rs=файл, --restart=файл - продолжить расчёт с сохранённого снимка; размеры автомата, "
+			<< "конфигурационный файл и включённые процессы должны быть теми же, что при сохранении\n"
+			<< "\n"
+			<< "  -pf=файл, --profile=файл - сохранять в файл таблицу затрат времени, числа вызовов, кандидатов "
+			<< "и событий по каждому процессу и выводу (только в программе, собранной с make PROFILE=1)\n"
+			<< "  -pfe=число, --profile-every=число - кроме конца расчёта, обновлять таблицу через каждые "
+			<< "столько выводов (по умолчанию 0 - только в конце)\n"
+			<< "\n"
+			<< "  -en=число, --ensemble=число - рассчитать в одном процессе ансамбль из стольких независимых "
+			<< "расчётов с зёрнами seed, seed + 1, ...; расчёты идут параллельно в потоках (-th), "
+			<< "инфо каждого расчёта и средние с дисперсиями по ансамблю пишутся в один файл ensemble "
+			<< "(или в стандартный поток вывода при -oi), другие выходные файлы не сохраняются\n"
+			<< "  -tg=T1,T2,..., --temperature-grid=T1,T2,... - ансамбль рассчитывается для каждой "
+			<< "из этих температур (К) вместо указанной в конфигурационном файле\n"
 			<< "\n"
 			<< "  -wo-dfd, --without-dimers-form-drop - не использовать образование/рызрыв димеров\n"
 			<< "  -wo-hm, --without-hydrogen-migration - не использовать миграцию водорода по димеру\n"
@@ -141,6 +228,10 @@ std::string Configurator::help() const {
 			<< "  -wo-bm-ud, --without-bridge-migration-up-down - отменить миграцию мостовой группы вверх-вниз "
 			<< "(миграция вверх-вниз не работает без \"обычной\" миграции)\n"
 			<< "\n"
+			<< "  -kmc, --kinetic - вместо постоянного шага по времени использовать бесшумовой кинетический "
+			<< "Монте-Карло: события выбираются по одному пропорционально скоростям, время между ними "
+			<< "экспоненциально распределено; счётчики событий в инфо относятся к промежутку между выводами\n"
+			<< "\n"
 			<< "  -oi, --only-info - выводить информацию в стандартный поток вывода и не сохранять выходные файлы\n"
 			<< "  -os, --only-specs - выводить содержащиеся виды в стандартный поток вывода и не сохранять выходные файлы\n"
 			<< "\n"
@@ -148,7 +239,22 @@ std::string Configurator::help() const {
 			<< "\n"
 			<< "  -wo-a, --without-area - не сохранять файл для визуализации\n"
 			<< "  -wo-i, --without-info - не сохранять инфо\n"
-			<< "  -w-s, --with-specs - сохранять содержащиеся виды в текстовом виде\n";
+			<< "  -w-s, --with-specs - сохранять содержащиеся виды в текстовом виде\n"
+			<< "  -ba, --binary-area - сохранять файл для визуализации в виде компактной двоичной траектории "
+			<< "(.dtrj): ключевые кадры и кадры только с изменившимися узлами\n"
+			<< "\n"
+			<< "  -sa, --surface-area - сохранять для визуализации только поверхностную оболочку: узлы со свободными "
+			<< "связями или с пустым узлом над ними\n"
+			<< "  -hm, --height-map - сохранять карту высот: для каждого столбца (x, y) наибольший Z занятого узла\n"
+			<< "  -mo, --morphology - отслеживать рельеф поверхности: в инфо добавляются средняя высота столбцов "
+			<< "и шероховатость (среднеквадратичное отклонение высот), а в файл morphology - число столбцов "
+			<< "каждой высоты и заполненность каждого слоя\n"
+			<< "\n"
+			<< "  -ao, --async-output - формировать и записывать выходные файлы в фоновом потоке по копии состояния, "
+			<< "чтобы расчёт не ждал вывода (расчёт приостанавливается, только если вывод отстаёт больше чем на кадр)\n"
+			<< "\n"
+			<< "  -ct=файл, --convert-trajectory=файл - преобразовать двоичную траекторию в текстовый файл "
+			<< "для визуализации (.wxyz) рядом с ней и завершить работу\n";
 
 	return result.str();
 }
@@ -8,7 +8,9 @@
 #ifndef CONFIGURATOR_H_
 #define CONFIGURATOR_H_
 
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "int3.h"
 #include "flags_config.h"
@@ -19,6 +21,7 @@
 //#define ANY_STEP 1000
 #define FULL_TIME 1
 #define ANY_TIME 0.1
+#define CHECKPOINT_TIME 3600
 
 namespace DiamondCA {
 
@@ -38,6 +41,16 @@ public:
 //	unsigned int anyStep() const { return _any_step; }
 	float fullTime() const { return _full_time; }
 	float anyTime() const { return _any_time; }
+	uint64_t seed() const { return _seed; }
+	unsigned int threads() const { return _threads; }
+	std::string checkpointFileName() const { return _checkpoint_file_name; }
+	unsigned int checkpointTime() const { return _checkpoint_time; }
+	std::string restartFileName() const { return _restart_file_name; }
+	std::string profileFileName() const { return _profile_file_name; }
+	unsigned int profileEvery() const { return _profile_every; }
+	unsigned int ensembleSize() const { return _ensemble_size; }
+	const std::vector<double>& temperatureGrid() const { return _temperature_grid; }
+	std::string trajectoryFileName() const { return _trajectory_file_name; }
 	FlagsConfig automataConfig() const { return _automata_config; }
 	FlagsConfig outputerConfig() const { return _outputer_config; }
 	std::string prefix() const { return _prefix; }
@@ -52,6 +65,16 @@ private:
 	std::string _initial_spec;
 //	unsigned int _steps, _any_step;
 	float _full_time, _any_time;
+	uint64_t _seed;
+	unsigned int _threads;
+	std::string _checkpoint_file_name;
+	unsigned int _checkpoint_time;
+	std::string _restart_file_name;
+	std::string _profile_file_name;
+	unsigned int _profile_every;
+	unsigned int _ensemble_size;
+	std::vector<double> _temperature_grid;
+	std::string _trajectory_file_name;
 	FlagsConfig _automata_config;
 	FlagsConfig _outputer_config;
 	std::string _prefix;
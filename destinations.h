@@ -0,0 +1,40 @@
+/*
+ * destinations.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef DESTINATIONS_H_
+#define DESTINATIONS_H_
+
+#include "int3.h"
+
+namespace DiamondCA {
+
+// Назначения миграции одной мостовой группы. Их не больше восьми (по два направления в каждую
+// сторону вдоль и поперёк димерных рядов, не больше двух узлов на направление), поэтому
+// они хранятся прямо в объекте, без выделения памяти: кэш назначений всех групп лежит
+// одним непрерывным массивом, а освободившиеся места занимают новые группы.
+class Destinations {
+public:
+	static const unsigned int MAX_SIZE = 8;
+
+	Destinations() : _size(0) { }
+
+	unsigned int size() const { return _size; }
+	bool empty() const { return _size == 0; }
+	void clear() { _size = 0; }
+
+	void push_back(const int3& coords) { _coords[_size++] = coords; }
+
+	const int3& operator[](unsigned int i) const { return _coords[i]; }
+
+private:
+	int3 _coords[MAX_SIZE];
+	unsigned int _size;
+};
+
+}
+
+#endif /* DESTINATIONS_H_ */
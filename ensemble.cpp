@@ -0,0 +1,108 @@
+/*
+ * ensemble.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <sstream>
+
+#include "automata.h"
+#include "ensemble.h"
+#include "outputer.h"
+#include "thread_pool.h"
+
+namespace DiamondCA {
+
+void Ensemble::Moments::add(const std::vector<double>& values) {
+	if (count == 0) {
+		mean.assign(values.size(), 0);
+		m2.assign(values.size(), 0);
+	}
+
+	++count;
+	for (unsigned int i = 0; i < values.size() && i < mean.size(); ++i) {
+		double delta = values[i] - mean[i];
+		mean[i] += delta / count;
+		m2[i] += delta * (values[i] - mean[i]);
+	}
+}
+
+Ensemble::Ensemble(const Handbook& handbook, const Configurator& cg) :
+		_cg(&cg), _replicas_num(cg.ensembleSize()), _os(0)
+{
+	const std::vector<double>& temperatures = cg.temperatureGrid();
+	if (temperatures.empty()) {
+		_handbooks.push_back(handbook);
+	} else {
+		for (unsigned int i = 0; i < temperatures.size(); ++i) {
+			_handbooks.push_back(handbook);
+			_handbooks.back().setTemperature(temperatures[i]);
+		}
+	}
+
+	_moments.resize(_handbooks.size());
+	_written_nums.assign(_handbooks.size(), 0);
+}
+
+void Ensemble::run(std::ostream& os) {
+	_os = &os;
+	os << "Replica\tTemperature (K)\tSeed\t" << Automata::infoHead(flagOf(_cg->outputerConfig(), "morphology"));
+
+	// каждый расчёт идёт в одном потоке, параллельны сами расчёты
+	ThreadPool pool(_cg->threads());
+	pool.run(_replicas_num * _handbooks.size(), [this](unsigned int index) { runReplica(index); });
+}
+
+void Ensemble::runReplica(unsigned int index) {
+	const Handbook& handbook = _handbooks[index / _replicas_num];
+
+	Replica replica(*this, index);
+	Outputer outputer(*_cg, replica);
+	Automata ca(handbook, _cg->automataConfig(), outputer);
+	ca.seed(_cg->seed() + index);
+	ca.stickInitialCells(_cg->initialSpec());
+	if (flagOf(_cg->outputerConfig(), "morphology")) ca.trackMorphology();
+	ca.run(_cg->fullTime(), _cg->anyTime());
+}
+
+void Ensemble::collect(unsigned int index, unsigned int out_index, const std::string& body) {
+	std::vector<double> values;
+	std::istringstream columns(body);
+	double value;
+	while (columns >> value) values.push_back(value);
+
+	unsigned int point = index / _replicas_num;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	*_os << index << '\t' << _handbooks[point].temperature() << '\t' << _cg->seed() + index << '\t' << body << '\n';
+
+	std::vector<Moments>& moments = _moments[point];
+	if (moments.size() <= out_index) moments.resize(out_index + 1);
+	moments[out_index].add(values);
+
+	// выводы записываются по порядку, как только их достигли все расчёты температуры
+	unsigned int& written_num = _written_nums[point];
+	while (written_num < moments.size() && moments[written_num].count == _replicas_num) {
+		writeMoments(point, moments[written_num]);
+		moments[written_num] = Moments();
+		++written_num;
+	}
+	_os->flush();
+}
+
+void Ensemble::writeMoments(unsigned int point, const Moments& moments) {
+	double temperature = _handbooks[point].temperature();
+
+	*_os << "mean\t" << temperature << "\t-";
+	for (unsigned int i = 0; i < moments.mean.size(); ++i) *_os << '\t' << moments.mean[i];
+	*_os << '\n';
+
+	*_os << "variance\t" << temperature << "\t-";
+	for (unsigned int i = 0; i < moments.m2.size(); ++i) {
+		*_os << '\t' << ((moments.count > 1) ? moments.m2[i] / (moments.count - 1) : 0);
+	}
+	*_os << '\n';
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+ * ensemble.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef ENSEMBLE_H_
+#define ENSEMBLE_H_
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "configurator.h"
+#include "handbook.h"
+#include "info_sink.h"
+
+namespace DiamondCA {
+
+// Ансамбль независимых расчётов в одном процессе: replicas_num расчётов с разными зёрнами
+// на каждую температуру сетки. Расчёты идут в пуле потоков и делят разобранный справочник.
+// Каждая строка инфо пишется сразу с номером расчёта, а средние и дисперсии по ансамблю -
+// как только все расчёты температуры дошли до очередного вывода.
+class Ensemble {
+public:
+	Ensemble(const Handbook& handbook, const Configurator& cg);
+	virtual ~Ensemble() { }
+
+	void run(std::ostream& os);
+
+private:
+	// накопление среднего и дисперсии по алгоритму Уэлфорда
+	struct Moments {
+		Moments() : count(0) { }
+
+		void add(const std::vector<double>& values);
+
+		unsigned int count;
+		std::vector<double> mean;
+		std::vector<double> m2;
+	};
+
+	class Replica : public InfoSink {
+	public:
+		Replica(Ensemble& ensemble, unsigned int index) : _ensemble(&ensemble), _index(index), _outputs_num(0) { }
+
+		void info(const std::string& body) { _ensemble->collect(_index, _outputs_num++, body); }
+
+	private:
+		Replica();
+		Replica(const Replica&);
+		Replica& operator=(const Replica&);
+
+	private:
+		Ensemble* _ensemble;
+		unsigned int _index;
+		unsigned int _outputs_num;
+	};
+
+	Ensemble();
+	Ensemble(const Ensemble&);
+	Ensemble& operator=(const Ensemble&);
+
+	void runReplica(unsigned int index);
+	void collect(unsigned int index, unsigned int out_index, const std::string& body);
+	void writeMoments(unsigned int point, const Moments& moments);
+
+private:
+	const Configurator* _cg;
+	unsigned int _replicas_num;
+
+	// справочник на каждую температуру сетки
+	std::vector<Handbook> _handbooks;
+
+	std::mutex _mutex;
+	std::ostream* _os;
+	// накопленные моменты по номерам выводов и число уже записанных выводов, для каждой температуры
+	std::vector<std::vector<Moments> > _moments;
+	std::vector<unsigned int> _written_nums;
+};
+
+}
+
+#endif /* ENSEMBLE_H_ */
@@ -8,6 +8,12 @@ namespace DiamondCA {
 
 typedef std::map<std::string, bool> FlagsConfig;
 
+// флаг, не заданный в конфигурации, принимает значение по умолчанию
+inline bool flagOf(const FlagsConfig& config, const std::string& name, bool default_value = false) {
+	FlagsConfig::const_iterator it = config.find(name);
+	return (it == config.end()) ? default_value : it->second;
+}
+
 }
 
 #endif /* FLAGS_CONFIG_H_ */
@@ -29,6 +29,7 @@ public:
 	double dt() const;
 
 	double temperature() const { return _temperature; }
+	void setTemperature(double temperature) { _temperature = temperature; }
 	double kMolecule(const std::string& key) const;
 
 	double percentOfNotDimers() const;
@@ -0,0 +1,52 @@
+/*
+ * indexed_set.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "indexed_set.h"
+
+namespace DiamondCA {
+
+IndexedSet::~IndexedSet() {
+	for (unsigned int i = 0; i < _pages.size(); ++i) delete[] _pages[i];
+}
+
+bool IndexedSet::insert(SiteId site) {
+	unsigned int& s = slotRef(site);
+	if (s != NO_INDEX) return false;
+
+	s = _members.size();
+	_members.push_back(site);
+	return true;
+}
+
+bool IndexedSet::erase(SiteId site) {
+	unsigned int s = slot(site);
+	if (s == NO_INDEX) return false;
+
+	SiteId last = _members.back();
+	_members[s] = last;
+	slotRef(last) = s;
+	_members.pop_back();
+	slotRef(site) = NO_INDEX;
+	return true;
+}
+
+void IndexedSet::clear() {
+	for (unsigned int i = 0; i < _members.size(); ++i) slotRef(_members[i]) = NO_INDEX;
+	_members.clear();
+}
+
+unsigned int& IndexedSet::slotRef(SiteId site) {
+	unsigned int page = site >> PAGE_BITS;
+	if (page >= _pages.size()) _pages.resize(page + 1, 0);
+	if (!_pages[page]) {
+		_pages[page] = new unsigned int[PAGE_SIZE];
+		for (int i = 0; i < PAGE_SIZE; ++i) _pages[page][i] = NO_INDEX;
+	}
+	return _pages[page][site & (PAGE_SIZE - 1)];
+}
+
+}
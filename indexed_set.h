@@ -0,0 +1,63 @@
+/*
+ * indexed_set.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef INDEXED_SET_H_
+#define INDEXED_SET_H_
+
+#include <vector>
+
+#include "lattice.h"
+
+namespace DiamondCA {
+
+// Множество узлов решётки: плотный массив элементов и индекс позиции каждого узла в этом массиве.
+// Вставка, удаление (с перестановкой последнего элемента на место удалённого), проверка
+// принадлежности и выбор элемента по номеру выполняются за O(1).
+// Индекс позиций хранится страницами, которые выделяются только при вставке узла из них,
+// поэтому память расходуется лишь на ту часть решётки, где есть элементы множества.
+class IndexedSet {
+public:
+	static const unsigned int NO_INDEX = (unsigned int)-1;
+
+	IndexedSet() { }
+	virtual ~IndexedSet();
+
+	unsigned int size() const { return _members.size(); }
+	bool empty() const { return _members.empty(); }
+	SiteId operator[](unsigned int index) const { return _members[index]; }
+	// элементы в порядке плотного массива
+	const SiteId* members() const { return _members.empty() ? 0 : &_members[0]; }
+
+	bool contains(SiteId site) const { return slot(site) != NO_INDEX; }
+	// позиция узла в плотном массиве или NO_INDEX; при удалении на место узла встаёт последний элемент
+	unsigned int indexOf(SiteId site) const { return slot(site); }
+
+	bool insert(SiteId site);
+	bool erase(SiteId site);
+	void clear();
+
+private:
+	enum { PAGE_BITS = 12, PAGE_SIZE = 1 << PAGE_BITS };
+
+	IndexedSet(const IndexedSet&);
+	IndexedSet& operator=(const IndexedSet&);
+
+	unsigned int slot(SiteId site) const {
+		unsigned int page = site >> PAGE_BITS;
+		if (page >= _pages.size() || !_pages[page]) return NO_INDEX;
+		return _pages[page][site & (PAGE_SIZE - 1)];
+	}
+	unsigned int& slotRef(SiteId site);
+
+private:
+	std::vector<SiteId> _members;
+	std::vector<unsigned int*> _pages;
+};
+
+}
+
+#endif /* INDEXED_SET_H_ */
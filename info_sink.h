@@ -0,0 +1,26 @@
+/*
+ * info_sink.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef INFO_SINK_H_
+#define INFO_SINK_H_
+
+#include <string>
+
+namespace DiamondCA {
+
+// приёмник строк инфо вместо выходных файлов (например, для ансамбля расчётов в одном процессе)
+class InfoSink {
+public:
+	virtual ~InfoSink() { }
+
+	// строка инфо очередного вывода, без перевода строки; может вызываться из потока фонового вывода
+	virtual void info(const std::string& body) = 0;
+};
+
+}
+
+#endif /* INFO_SINK_H_ */
@@ -13,6 +13,10 @@ struct int3 {
 
 		return result;
 	}
+
+	bool operator==(const int3& oi) const {
+		return x == oi.x && y == oi.y && z == oi.z;
+	}
 };
 
 #endif /* INT3_H_ */
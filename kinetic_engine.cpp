@@ -0,0 +1,208 @@
+/*
+ * kinetic_engine.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "kinetic_engine.h"
+#include "outputer.h"
+
+namespace DiamondCA {
+
+KineticEngine::KineticEngine(Automata& ca) :
+		_ca(&ca), _rates(ca._lattice.volume()), _random(&ca._random[Automata::KINETIC_EVENTS])
+{
+	const Handbook& handbook = *_ca->_handbook;
+
+	_k[ABSTRACT_H] = _ca->enabled(Automata::WITH_SURFACE_ACTIVATION) ? handbook.kMolecule("abs_H") : 0;
+	_k[ADSORB_H] = _ca->enabled(Automata::WITH_SURFACE_DEACTIVATION) ? handbook.kMolecule("add_H") : 0;
+	_k[MIGRATE_H] = _ca->enabled(Automata::WITH_HYDROGEN_MIGRATION) ? handbook.kMolecule("migrate_H") : 0;
+	_k[ADSORB_CH3] = _ca->enabled(Automata::WITH_METHYL_ADSORPTION) ? handbook.kMolecule("add_CH3") : 0;
+	_k[FORM_DIMER] = _ca->enabled(Automata::WITH_DIMERS_FORM_DROP) ? handbook.kMolecule("create_dimer") : 0;
+	_k[DROP_DIMER] = _ca->enabled(Automata::WITH_DIMERS_FORM_DROP) ? handbook.kMolecule("drop_dimer") : 0;
+	// в шаговом расчёте мостовая группа пытается мигрировать один раз за dt
+	_k[MIGRATE_BRIDGE] = _ca->enabled(Automata::WITH_BRIDGE_MIGRATION) ? 1 / handbook.dt() : 0;
+}
+
+void KineticEngine::run(float full_time, float out_any_time) {
+	for (SiteId site = 0; site < _ca->_lattice.volume(); ++site) {
+		if (!_ca->_lattice[site].empty()) updateRate(site);
+	}
+
+	double any_time = (out_any_time > 0) ? out_any_time : _ca->_dt;
+	double percent_time = full_time * 0.001;
+	// время и номера выводов хранятся в автомате, чтобы расчёт можно было продолжить со снимка
+	Automata::Progress& progress = _ca->_progress;
+
+	while (true) {
+		double total = _rates.total();
+		double next_time = (total > 0) ? progress.time - log(_random->uniform()) / total : full_time + any_time;
+
+		// состояние не меняется до следующего события, поэтому все попавшие в ожидание моменты
+		// вывода получают текущее состояние
+		while (progress.percent_index * percent_time <= next_time && progress.percent_index <= 1000) {
+			_ca->_outputer->outputPercent(0.1 * progress.percent_index++);
+		}
+		while (progress.out_index * any_time <= next_time && progress.out_index * any_time <= full_time) {
+			output(progress.out_index++ * any_time);
+		}
+
+		if (next_time > full_time) break;
+
+		progress.time = next_time;
+		doEvent();
+
+		if (_ca->checkpointIfRequested()) break;
+	}
+}
+
+double KineticEngine::siteRates(SiteId site, double rates[EVENTS_NUM]) {
+	for (int e = 0; e < EVENTS_NUM; ++e) rates[e] = 0;
+
+	const Lattice& lattice = _ca->_lattice;
+	const Cell& cell = lattice[site];
+	if (cell.empty()) return 0;
+
+	rates[ABSTRACT_H] = _k[ABSTRACT_H] * cell.hydro();
+	rates[ADSORB_H] = _k[ADSORB_H] * cell.active();
+
+	if (cell.isDimer()) {
+		const Cell& partner = lattice[_ca->partnerSite(site)];
+		// как и в шаговом расчёте, водород мигрирует в димере с частотой k один раз, поэтому если
+		// мигрировать он может в обе стороны, каждая сторона получает половину скорости
+		if (cell.active() > 0 && partner.hydro() > 0) {
+			bool is_both_ways = (partner.active() > 0 && cell.hydro() > 0);
+			rates[MIGRATE_H] = _k[MIGRATE_H] * (is_both_ways ? 0.5 : 1);
+		}
+		// если активны оба конца димера, метил садится на каждый с равной вероятностью
+		if (cell.active() > 0) rates[ADSORB_CH3] = _k[ADSORB_CH3] * ((partner.active() > 0) ? 0.5 : 1);
+		// разрыв димера приписывается тому концу, чей партнёр - больший прямой сосед
+		if (cell.partner() == 1) rates[DROP_DIMER] = _k[DROP_DIMER];
+	} else if (cell.active() > 0 && _k[FORM_DIMER] > 0 && _ca->isDimerFormable(site, 1)) {
+		// пара с меньшим соседом учитывается в узле этого соседа
+		rates[FORM_DIMER] = _k[FORM_DIMER];
+	}
+
+	_destinations.clear();
+	if (_k[MIGRATE_BRIDGE] > 0 && Automata::isBridge(cell)) {
+		_destinations = _ca->cachedBridgeDestinations(site, _destinations);
+		// как и в шаговом расчёте, с вероятностью 1 / (n + 1) группа остаётся на месте
+		unsigned int n = _destinations.size();
+		rates[MIGRATE_BRIDGE] = _k[MIGRATE_BRIDGE] * n / (n + 1);
+	}
+
+	double total = 0;
+	for (int e = 0; e < EVENTS_NUM; ++e) total += rates[e];
+	return total;
+}
+
+void KineticEngine::updateRate(SiteId site) {
+	double rates[EVENTS_NUM];
+	_rates.setRate(site, siteRates(site, rates));
+}
+
+void KineticEngine::refreshAround(SiteId site) {
+	// скорости всех событий, кроме миграции мостовой группы, зависят только от ближайших соседей;
+	// мостовая группа же просматривает узлы на два слоя ниже и на слой выше себя,
+	// и не дальше трёх клеток по X и Y
+	const Lattice& lattice = _ca->_lattice;
+	const int3& sizes = lattice.sizes();
+	int3 coords = lattice.coords(site);
+	for (int dz = -1; dz <= 2; ++dz) {
+		int z = coords.z + dz;
+		if (z < 0 || z >= sizes.z) continue;
+
+		for (int dy = -3; dy <= 3; ++dy) {
+			int y = (coords.y + dy + sizes.y) % sizes.y;
+			for (int dx = -3; dx <= 3; ++dx) {
+				int x = (coords.x + dx + sizes.x) % sizes.x;
+				SiteId neighbour = lattice.site(int3(z, y, x));
+
+				bool is_near = (dz < 2 && dy >= -1 && dy <= 1 && dx >= -1 && dx <= 1);
+				if (!is_near && !Automata::isBridge(lattice[neighbour])) continue;
+				updateRate(neighbour);
+			}
+		}
+	}
+}
+
+void KineticEngine::doEvent() {
+	double value = _random->uniform() * _rates.total();
+	SiteId site = _rates.find(value);
+
+	double rates[EVENTS_NUM];
+	siteRates(site, rates);
+
+	int event = EVENTS_NUM - 1;
+	for (int e = 0; e < EVENTS_NUM; ++e) {
+		if (rates[e] == 0) continue;
+		event = e;
+		if (value < rates[e]) break;
+		value -= rates[e];
+	}
+
+	PROFILE_SCOPE(_ca->_profiler, KINETIC_EVENTS, 0);
+	PROFILE_EVENTS(1);
+
+	_touched_sites.clear();
+	_ca->nextEpoch();
+	_ca->_touched_sites = &_touched_sites;
+
+	SiteId partner_site;
+	switch (event) {
+	case ABSTRACT_H:
+		_ca->removeHydrogen(site);
+		++_ca->_abstracted_hydrogen_atoms_num;
+		break;
+	case ADSORB_H:
+		_ca->addHydrogen(site);
+		++_ca->_adsorbed_hydrogen_atoms_num;
+		break;
+	case MIGRATE_H:
+		_ca->migrateHydrogen(site, _ca->partnerSite(site));
+		++_ca->_migrated_hydrogen_atoms_num;
+		break;
+	case ADSORB_CH3:
+		_ca->adsorbMethyl(site, _ca->partnerSite(site));
+		++_ca->_adsorbed_methyl_radicals_num;
+		break;
+	case FORM_DIMER:
+		_ca->formDimer(site, 1);
+		break;
+	case DROP_DIMER:
+		partner_site = _ca->partnerSite(site);
+		_ca->dropDimer(site, partner_site);
+		break;
+	case MIGRATE_BRIDGE:
+		_ca->migrateBridge(site, _destinations[_random->bounded(_destinations.size())]);
+		++_ca->_migrated_bridges_num;
+		break;
+	}
+
+	_ca->_touched_sites = 0;
+
+	std::sort(_touched_sites.begin(), _touched_sites.end());
+	_touched_sites.erase(std::unique(_touched_sites.begin(), _touched_sites.end()), _touched_sites.end());
+	for (VariantSites::const_iterator it = _touched_sites.begin(); it != _touched_sites.end(); ++it) {
+		refreshAround(*it);
+	}
+}
+
+void KineticEngine::output(double time) {
+	_ca->_time = time;
+	_ca->recountSurface();
+	_ca->outputStep();
+
+	// счётчики событий в выводе относятся к промежутку между соседними выводами
+	_ca->_abstracted_hydrogen_atoms_num = 0;
+	_ca->_adsorbed_hydrogen_atoms_num = 0;
+	_ca->_adsorbed_methyl_radicals_num = 0;
+	_ca->_migrated_hydrogen_atoms_num = 0;
+	_ca->_migrated_bridges_num = 0;
+}
+
+}
@@ -0,0 +1,59 @@
+/*
+ * kinetic_engine.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef KINETIC_ENGINE_H_
+#define KINETIC_ENGINE_H_
+
+#include "automata.h"
+#include "rate_tree.h"
+
+namespace DiamondCA {
+
+// Бесшумовой (rejection-free, BKL) кинетический Монте-Карло: для каждого узла решётки хранится
+// суммарная скорость возможных в нём событий, очередное событие выбирается пропорционально скорости,
+// а время продвигается на экспоненциально распределённое время ожидания.
+class KineticEngine {
+public:
+	KineticEngine(Automata& ca);
+	virtual ~KineticEngine() { }
+
+	void run(float full_time, float out_any_time);
+
+private:
+	enum Event {
+		ABSTRACT_H,
+		ADSORB_H,
+		MIGRATE_H,
+		ADSORB_CH3,
+		FORM_DIMER,
+		DROP_DIMER,
+		MIGRATE_BRIDGE,
+		EVENTS_NUM
+	};
+
+	KineticEngine();
+
+	double siteRates(SiteId site, double rates[EVENTS_NUM]);
+	void updateRate(SiteId site);
+	void refreshAround(SiteId site);
+
+	void doEvent();
+	void output(double time);
+
+private:
+	Automata* _ca;
+	RateTree _rates;
+	Random* _random;
+
+	double _k[EVENTS_NUM];
+	Destinations _destinations;
+	VariantSites _touched_sites;
+};
+
+}
+
+#endif /* KINETIC_ENGINE_H_ */
@@ -0,0 +1,200 @@
+/*
+ * lattice.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include "lattice.h"
+
+namespace DiamondCA {
+
+// столько страниц общего файла отображается подряд, чтобы соседние отображения сливались
+#define BULK_FILE_PAGES 256
+
+Lattice::Lattice(const int3& sizes) :
+		_sizes(sizes), _mapped_size(0), _page_size(sysconf(_SC_PAGESIZE)), _archived_pages_num(0),
+		_bulk_fd(-1), _bulk(0), _archiving_failed(false)
+{
+	_layer_size = _sizes.x * _sizes.y;
+	_volume = _layer_size * _sizes.z;
+
+	// анонимное отображение заполнено нулями (пустыми узлами), а память под страницу выделяется
+	// только при первой записи в неё
+	unsigned int pages_num = ((size_t)_volume + _page_size - 1) / _page_size;
+	size_t size = (size_t)pages_num * _page_size;
+	void* cells = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (cells != MAP_FAILED) {
+		_cells = (Cell*)cells;
+		_mapped_size = size;
+	} else {
+		_cells = new Cell[_volume];
+	}
+
+	_shared_pages.assign(pages_num, false);
+	_dirty_pages = new std::atomic<unsigned char>[pages_num];
+	for (unsigned int page = 0; page < pages_num; ++page) _dirty_pages[page].store(1, std::memory_order_relaxed);
+}
+
+Lattice::~Lattice() {
+	if (_mapped_size > 0) {
+		munmap(_cells, _mapped_size);
+	} else {
+		delete[] _cells;
+	}
+	delete[] _dirty_pages;
+	if (_bulk_fd >= 0) close(_bulk_fd);
+}
+
+void Lattice::assign(const Cell* cells) {
+	for (size_t begin = 0; begin < _volume; begin += _page_size) {
+		size_t size = (begin + _page_size <= _volume) ? _page_size : _volume - begin;
+		if (memcmp(_cells + begin, cells + begin, size) == 0) continue;
+		memcpy(_cells + begin, cells + begin, size);
+		touch(begin);
+	}
+}
+
+void Lattice::assign(const Lattice& source) {
+	if (_mapped_size == 0 || _archiving_failed || source._bulk_fd < 0) {
+		assign(source._cells);
+		return;
+	}
+
+	// общая страница источника, не изменённая после проверки, заведомо заполнена его узлами _bulk
+	unsigned int run_first = 0, run_length = 0;
+	for (unsigned int page = 0; page < pagesNum(); ++page) {
+		bool is_bulk = source._shared_pages[page] && source._dirty_pages[page].load(std::memory_order_relaxed) == 0
+				&& (_bulk_fd < 0 || _bulk == source._bulk);
+		if (is_bulk && !_shared_pages[page]) {
+			if (run_length == 0) run_first = page;
+			++run_length;
+			if (run_length < BULK_FILE_PAGES) continue;
+		}
+
+		if (run_length > 0 && !mapBulkPages(run_first, run_length, source._bulk)) {
+			assign(source._cells);
+			return;
+		}
+		run_length = 0;
+		if (is_bulk) continue;
+
+		size_t begin = (size_t)page * _page_size;
+		size_t size = (begin + _page_size <= _volume) ? _page_size : _volume - begin;
+		if (memcmp(_cells + begin, source._cells + begin, size) == 0) continue;
+		unshare(page);
+		memcpy(_cells + begin, source._cells + begin, size);
+		touch(begin);
+	}
+	if (run_length > 0 && !mapBulkPages(run_first, run_length, source._bulk)) assign(source._cells);
+}
+
+void Lattice::archive(SiteId end, const Cell& bulk) {
+	if (_mapped_size == 0 || _archiving_failed) return;
+
+	unsigned char bulk_byte = *(const unsigned char*)&bulk;
+	if (_bulk_fd >= 0 && bulk_byte != _bulk) return;
+
+	unsigned int end_page = end / _page_size;
+	unsigned int run_first = 0, run_length = 0;
+	for (unsigned int page = 0; page < end_page; ++page) {
+		// неизменённые страницы либо уже общие, либо при прошлой проверке не подошли
+		bool is_bulk = false;
+		if (_dirty_pages[page].exchange(0, std::memory_order_relaxed) != 0) {
+			// в общую страницу писали, и у неё теперь собственная копия
+			unshare(page);
+			is_bulk = isUniformPage(page, bulk_byte);
+		}
+		if (is_bulk) {
+			if (run_length == 0) run_first = page;
+			++run_length;
+			if (run_length < BULK_FILE_PAGES) continue;
+		}
+
+		if (run_length > 0 && !mapBulkPages(run_first, run_length, bulk_byte)) {
+			// проверка повторится при следующем вызове
+			for (unsigned int p = run_first; p < run_first + run_length; ++p) {
+				_dirty_pages[p].store(1, std::memory_order_relaxed);
+			}
+			return;
+		}
+		run_length = 0;
+	}
+	if (run_length > 0 && !mapBulkPages(run_first, run_length, bulk_byte)) {
+		for (unsigned int p = run_first; p < run_first + run_length; ++p) {
+			_dirty_pages[p].store(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool Lattice::isUniformPage(unsigned int page, unsigned char bulk) const {
+	const unsigned char* bytes = (const unsigned char*)(_cells + (size_t)page * _page_size);
+	for (unsigned int i = 0; i < _page_size; ++i) {
+		if (bytes[i] != bulk) return false;
+	}
+	return true;
+}
+
+void Lattice::unshare(unsigned int page) {
+	if (!_shared_pages[page]) return;
+	_shared_pages[page] = false;
+	--_archived_pages_num;
+}
+
+bool Lattice::mapBulkPages(unsigned int first_page, unsigned int pages_num, unsigned char bulk) {
+	if (_bulk_fd < 0) {
+		// файл без имени в памяти: не зависит от /tmp и исчезает вместе с процессом
+		int fd = memfd_create("diamond-bulk", MFD_CLOEXEC);
+		if (fd < 0) {
+			disableArchiving("memfd_create");
+			return false;
+		}
+
+		std::vector<unsigned char> bytes((size_t)BULK_FILE_PAGES * _page_size, bulk);
+		if (write(fd, &bytes[0], bytes.size()) != (ssize_t)bytes.size()) {
+			disableArchiving("write");
+			close(fd);
+			return false;
+		}
+		_bulk_fd = fd;
+		_bulk = bulk;
+	}
+
+	// частное отображение: при записи страница копируется, и файл остаётся неизменным
+	void* address = _cells + (size_t)first_page * _page_size;
+	size_t size = (size_t)pages_num * _page_size;
+	void* mapped = mmap(address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, _bulk_fd, 0);
+	if (mapped == MAP_FAILED) {
+		disableArchiving("mmap");
+		// прежнее отображение диапазона могло быть уже снято: страницы восстанавливаются
+		// анонимными, с тем же содержимым
+		mapped = mmap(address, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+		if (mapped == MAP_FAILED) {
+			std::cerr << "Cannot restore lattice pages: " << strerror(errno) << std::endl;
+			abort();
+		}
+		memset(address, bulk, size);
+		for (unsigned int page = first_page; page < first_page + pages_num; ++page) unshare(page);
+		return false;
+	}
+
+	for (unsigned int page = first_page; page < first_page + pages_num; ++page) _shared_pages[page] = true;
+	_archived_pages_num += pages_num;
+	return true;
+}
+
+void Lattice::disableArchiving(const char* call) {
+	std::cerr << "Bulk pages are not archived: " << call << " failed: " << strerror(errno) << std::endl;
+	_archiving_failed = true;
+}
+
+}
@@ -0,0 +1,110 @@
+/*
+ * lattice.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef LATTICE_H_
+#define LATTICE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "int3.h"
+#include "cell.h"
+
+namespace DiamondCA {
+
+typedef unsigned int SiteId;
+
+// Вся решётка хранится одним непрерывным массивом состояний узлов,
+// узел адресуется упакованным номером (z * Y + y) * X + x.
+// Массив отображается в память без начального заполнения, поэтому страницы ещё пустых слоёв
+// не занимают памяти, пока в них ничего не записано. Страницы погребённого объёма, целиком
+// состоящие из одинаковых узлов, заменяются отображениями одной общей страницы (см. archive()).
+// Изменяющий узлы отмечает это через touch(), так что заново проверяются лишь изменённые страницы.
+class Lattice {
+public:
+	static const SiteId NO_SITE = (SiteId)-1;
+
+	Lattice(const int3& sizes);
+	virtual ~Lattice();
+
+	const int3& sizes() const { return _sizes; }
+	unsigned int volume() const { return _volume; }
+
+	bool contains(const int3& coords) const { return coords.z >= 0 && coords.z < _sizes.z; }
+
+	SiteId site(const int3& coords) const {
+		return ((SiteId)coords.z * _sizes.y + coords.y) * _sizes.x + coords.x;
+	}
+	int3 coords(SiteId site) const {
+		unsigned int xy = site % _layer_size;
+		return int3(site / _layer_size, xy / _sizes.x, xy % _sizes.x);
+	}
+
+	// номер занятого узла или NO_SITE, если узел пуст или лежит вне решётки
+	SiteId occupied(const int3& coords) const {
+		if (!contains(coords)) return NO_SITE;
+		SiteId s = site(coords);
+		return _cells[s].empty() ? NO_SITE : s;
+	}
+
+	Cell& operator[](SiteId site) { return _cells[site]; }
+	const Cell& operator[](SiteId site) const { return _cells[site]; }
+
+	// состояния всех узлов подряд, по одному байту на узел
+	Cell* cells() { return _cells; }
+	const Cell* cells() const { return _cells; }
+
+	// узел изменён (можно вызывать из нескольких потоков одновременно)
+	void touch(SiteId site) {
+		_dirty_pages[site / _page_size].store(1, std::memory_order_relaxed);
+	}
+
+	// копирует состояния всех узлов, не трогая страниц, где они не изменились (например, пустых)
+	void assign(const Cell* cells);
+	// то же из решётки того же размера; её общие страницы становятся общими и здесь
+	void assign(const Lattice& source);
+
+	// страницы узлов с номерами меньше end, целиком заполненные узлами bulk, делит общая страница;
+	// запись в такую страницу по-прежнему допустима (она получает собственную копию). Страница,
+	// не подошедшая раньше, проверяется снова, если после этого в ней менялись узлы
+	void archive(SiteId end, const Cell& bulk);
+	unsigned int archivedBytes() const { return _archived_pages_num * _page_size; }
+
+private:
+	Lattice(const Lattice&);
+	Lattice& operator=(const Lattice&);
+
+	unsigned int pagesNum() const { return _shared_pages.size(); }
+	bool isUniformPage(unsigned int page, unsigned char bulk) const;
+	bool mapBulkPages(unsigned int first_page, unsigned int pages_num, unsigned char bulk);
+	// сообщает о неудавшемся системном вызове и больше не обобщает страниц
+	void disableArchiving(const char* call);
+	void unshare(unsigned int page);
+
+private:
+	int3 _sizes;
+	unsigned int _layer_size;
+	unsigned int _volume;
+	Cell* _cells;
+
+	// размер отображения, если массив отображён (0 - обычный массив в куче)
+	size_t _mapped_size;
+	unsigned int _page_size;
+	// страницы, отображённые на общий файл, и страницы, изменённые после последней проверки
+	std::vector<bool> _shared_pages;
+	std::atomic<unsigned char>* _dirty_pages;
+	unsigned int _archived_pages_num;
+	// файл, заполненный узлами погребённого объёма (их состояние - _bulk), -1 - ещё не создан
+	int _bulk_fd;
+	unsigned char _bulk;
+	bool _archiving_failed;
+};
+
+}
+
+#endif /* LATTICE_H_ */
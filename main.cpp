@@ -1,12 +1,19 @@
+#include <ctime>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "automata.h"
+#include "checkpoint_error.h"
 #include "configurator.h"
+#include "ensemble.h"
 #include "handbook.h"
 #include "outputer.h"
 #include "parse_error.h"
 #include "parse_config_error.h"
 #include "parse_params_error.h"
+#include "trajectory.h"
+#include "trajectory_error.h"
 
 using namespace DiamondCA;
 
@@ -15,12 +22,12 @@ int main(int argc, char* argv[]) {
 
 	try {
 		configurator.parseParams(argc, argv);
-	} catch(const ParseParamsError* e) {
-		std::cerr << e->getMessage() << '\n'
+	} catch(const ParseParamsError& e) {
+		std::cerr << e.getMessage() << '\n'
 				<< "See " << configurator.programName() << " --help" << std::endl;
 		return 1;
-	} catch(const ParseError* e) {
-		std::cerr << e->getMessage() << std::endl;
+	} catch(const ParseError& e) {
+		std::cerr << e.getMessage() << std::endl;
 		return 1;
 	}
 
@@ -29,30 +36,74 @@ int main(int argc, char* argv[]) {
 		return 0;
 	}
 
+	if (configurator.trajectoryFileName() != "") {
+		std::string text_file_name = configurator.trajectoryFileName();
+		std::string::size_type extension = text_file_name.rfind(".dtrj");
+		if (extension != std::string::npos && extension + 5 == text_file_name.size()) text_file_name.erase(extension);
+		text_file_name += ".wxyz";
+
+		try {
+			TrajectoryReader trajectory(configurator.trajectoryFileName());
+			std::ofstream text_file(text_file_name.c_str());
+			trajectory.writeText(text_file);
+		} catch(const TrajectoryError& e) {
+			std::cerr << e.getMessage() << std::endl;
+			return 1;
+		}
+		return 0;
+	}
+
 	Handbook handbook;
 	try {
 		handbook.parseConfig(configurator.configFileName());
-	} catch(const ParseConfigError* e) {
+	} catch(const ParseConfigError& e) {
 		std::cerr << "Configuration file (" << configurator.configFileName() << ") contains error: "
-				<< e->getMessage() << std::endl;
+				<< e.getMessage() << std::endl;
 		return 1;
 	}
 	handbook.setSizes(configurator.sizes());
 
+	if (configurator.ensembleSize() > 0) {
+		Ensemble ensemble(handbook, configurator);
+		if (flagOf(configurator.outputerConfig(), "only-info")) {
+			ensemble.run(std::cout);
+		} else {
+			std::stringstream ensemble_file_name;
+			if (configurator.prefix() != "") ensemble_file_name << configurator.prefix() << '-';
+			ensemble_file_name << "out-ensemble-" << time(0) << ".txt";
+			std::ofstream ensemble_file(ensemble_file_name.str().c_str());
+			ensemble.run(ensemble_file);
+		}
+		return 0;
+	}
+
 	Outputer outputer(configurator);
 	outputer.outputConfigInfo(handbook);
 
 	Automata ca(handbook, configurator.automataConfig(), outputer);
-	ca.stickToCells(configurator.initialSpec(), Range(1, 1));
-	ca.stickToCells("*", Range(1, 1), Range(1, 2), Range(1, 2));
-	ca.stickToCells("*", Range(2, 2), Range(1, 2), Range(1, 1));
-	ca.stickToCells("*H", Range(3, 3), Range(2, 2), Range(1, 1));
-	ca.stickToCells("*", Range(1, 1), Range(4, 5), Range(4, 5));
-	ca.stickToCells("*", Range(2, 2), Range(4, 5), Range(4, 4));
-	ca.stickToCells("*H", Range(3, 3), Range(5, 5), Range(4, 4));
-	ca.stickToCells("*", Range(1, 1), Range(7, 8), Range(7, 8));
-	ca.stickToCells("*", Range(2, 2), Range(7, 8), Range(7, 7));
-	ca.stickToCells("*H", Range(3, 3), Range(8, 8), Range(7, 7));
+	ca.seed(configurator.seed());
+	ca.setThreads(configurator.threads());
+	if (configurator.restartFileName() != "") {
+		try {
+			ca.restore(configurator.restartFileName());
+		} catch(const CheckpointError& e) {
+			std::cerr << e.getMessage() << std::endl;
+			return 1;
+		}
+	} else {
+		ca.stickInitialCells(configurator.initialSpec());
+	}
+	FlagsConfig outputer_config = configurator.outputerConfig();
+	if (flagOf(outputer_config, "surface-area") || flagOf(outputer_config, "height-map")) ca.trackSurfaceShell();
+	if (flagOf(outputer_config, "morphology")) ca.trackMorphology();
+	if (configurator.checkpointFileName() != "") {
+		ca.setCheckpoint(configurator.checkpointFileName(), configurator.checkpointTime());
+	}
+
+	if (configurator.profileFileName() != "") {
+		ca.setProfile(configurator.profileFileName(), configurator.profileEvery());
+	}
+
 	ca.run(configurator.fullTime(), configurator.anyTime());
 
 	outputer.outputCalcTime();
@@ -13,15 +13,30 @@
 #include "cell.h"
 #include "outputer.h"
 
+#define ASYNC_FRAMES_NUM 2
+
 namespace DiamondCA {
 
-Outputer::Outputer(const Configurator& cg) : _cg(&cg) {
-	_config = _cg->outputerConfig();
+Outputer::Outputer(const Configurator& cg, std::ostream& console) :
+		_cg(&cg), _console(&console), _info_sink(0), _trajectory(0),
+		_render_pool(0), _renderer(0), _writer(0), _frames_num(0)
+{
+	const FlagsConfig& config = _cg->outputerConfig();
+	_only_info = flagOf(config, "only-info");
+	_only_specs = flagOf(config, "only-specs");
+	_clear_output_buffers = flagOf(config, "clear-output-buffers");
+	_with_info = !flagOf(config, "without-info", true);
+	_with_area = !flagOf(config, "without-area", true);
+	_with_specs = flagOf(config, "with-specs");
+	_binary_area = flagOf(config, "binary-area");
+	_async_output = flagOf(config, "async-output");
+	_surface_area = flagOf(config, "surface-area");
+	_height_map = flagOf(config, "height-map");
+	_morphology = flagOf(config, "morphology");
+
 	_start_time = time(0);
 
-	if (!(_config.count("only-info") > 0 && _config.find("only-info")->second)
-			&& !(_config.count("only-specs") > 0 && _config.find("only-specs")->second))
-	{
+	if (!_only_info && !_only_specs) {
 		std::string prefix = _cg->prefix();
 		std::stringstream full_prefix;
 		if (prefix != "") full_prefix << prefix << '-';
@@ -31,50 +46,184 @@ Outputer::Outputer(const Configurator& cg) : _cg(&cg) {
 		percent_file_name << full_prefix.str() << "percent-" << _start_time << ".txt";
 		_percent_file.open(percent_file_name.str().c_str());
 
-		if (!(_config.count("without-info") == 0 || _config.find("without-info")->second)) {
+		if (_with_info) {
 			std::stringstream info_file_name;
 			info_file_name << full_prefix.str() << "info-" << _start_time << ".txt";
 			_info_file.open(info_file_name.str().c_str());
 		}
 
-		if (!(_config.count("without-area") == 0 || _config.find("without-area")->second)) {
+		if (_with_area) {
 			std::stringstream area_file_name;
-			area_file_name << full_prefix.str() << "area-" << _start_time << ".wxyz";
-			_area_file.open(area_file_name.str().c_str());
+			area_file_name << full_prefix.str() << "area-" << _start_time;
+			if (_binary_area) {
+				// размеры решётки известны только автомату, поэтому траектория создаётся при первом выводе
+				_trajectory_file_name = area_file_name.str() + ".dtrj";
+			} else {
+				area_file_name << ".wxyz";
+				_area_file.open(area_file_name.str().c_str());
+			}
 		}
 
-		if (_config.count("with-specs") > 0 && _config.find("with-specs")->second) {
+		if (_with_specs) {
 			std::stringstream specs_file_name;
 			specs_file_name << full_prefix.str() << "specs-" << _start_time << ".txt";
 			_specs_file.open(specs_file_name.str().c_str());
 		}
+
+		if (_height_map) {
+			std::stringstream height_file_name;
+			height_file_name << full_prefix.str() << "height-" << _start_time << ".txt";
+			_height_file.open(height_file_name.str().c_str());
+		}
+
+		if (_morphology) {
+			std::stringstream morphology_file_name;
+			morphology_file_name << full_prefix.str() << "morphology-" << _start_time << ".txt";
+			_morphology_file.open(morphology_file_name.str().c_str());
+		}
 	}
 
-	if (_config.count("only-info") > 0 && _config.find("only-info")->second) {
-		outInfoHead(std::cout);
-	} else if (!(_config.count("without-info") == 0 || _config.find("without-info")->second)) {
+	if (_only_info) {
+		outInfoHead(*_console);
+	} else if (_with_info) {
 		outInfoHead(_info_file);
 	}
+
+	if (_async_output) {
+		_writer = new AsyncWriter(ASYNC_FRAMES_NUM);
+		_frames.resize(ASYNC_FRAMES_NUM);
+	}
+}
+
+Outputer::Outputer(const Configurator& cg, InfoSink& sink) :
+		_only_info(true), _only_specs(false), _clear_output_buffers(false), _with_info(false),
+		_with_area(false), _binary_area(false), _async_output(false), _surface_area(false),
+		_height_map(false), _morphology(false), _with_specs(false),
+		_cg(&cg), _console(0), _info_sink(&sink), _trajectory(0),
+		_render_pool(0), _renderer(0), _writer(0), _frames_num(0)
+{
+	_start_time = time(0);
+}
+
+Outputer::~Outputer() {
+	// сначала дописываются все кадры
+	delete _writer;
+	for (unsigned int i = 0; i < _frames.size(); ++i) delete _frames[i].lattice_copy;
+	delete _trajectory;
+	delete _renderer;
+	delete _render_pool;
+}
+
+AreaRenderer& Outputer::renderer() {
+	if (!_renderer) {
+		if (_cg->threads() > 1) _render_pool = new ThreadPool(_cg->threads());
+		_renderer = new AreaRenderer(_ca->sizes(), _render_pool);
+	}
+	return *_renderer;
+}
+
+TrajectoryWriter& Outputer::trajectory() {
+	if (!_trajectory) _trajectory = new TrajectoryWriter(_trajectory_file_name, _ca->sizes());
+	return *_trajectory;
 }
 
 void Outputer::outputStep() {
-	if (_config.count("only-info") > 0 && _config.find("only-info")->second) {
-		outInfoBody(std::cout);
-	} else if (_config.count("only-specs") > 0 && _config.find("only-specs")->second) {
-		outSpecs(std::cout);
+	if (!_writer) {
+		takeStep(_frame, false);
+		writeStep(_frame);
+		return;
+	}
+
+	_writer->waitForRoom();
+	StepFrame& frame = _frames[_frames_num++ % _frames.size()];
+	takeStep(frame, true);
+	_writer->post([this, &frame]() { writeStep(frame); });
+}
+
+void Outputer::takeStep(StepFrame& frame, bool is_copy) {
+	frame.info = _ca->infoBody();
+
+	frame.cells = 0;
+	if (needCells()) {
+		const Lattice& lattice = _ca->lattice();
+		if (is_copy) {
+			if (!frame.lattice_copy) frame.lattice_copy = new Lattice(lattice.sizes());
+			frame.lattice_copy->assign(lattice);
+			frame.cells = frame.lattice_copy->cells();
+		} else {
+			frame.cells = lattice.cells();
+		}
+	}
+
+	if (needShell()) _ca->surfaceShell(frame.shell_sites, frame.shell_cells);
+	if (needMorphology()) _ca->morphology(frame.heights_nums, frame.layers_carbons);
+}
+
+void Outputer::writeStep(const StepFrame& frame) {
+	if (_info_sink) {
+		_info_sink->info(frame.info);
+	} else if (_only_info) {
+		outInfoBody(*_console, frame.info);
+	} else if (_only_specs) {
+		outSpecs(*_console, frame.cells);
 	} else {
-		if (!(_config.count("without-info") == 0 || _config.find("without-info")->second)) {
-			outInfoBody(_info_file);
+		if (_with_info) {
+			outInfoBody(_info_file, frame.info);
 		}
 
-		if (!(_config.count("without-area") == 0 || _config.find("without-area")->second)) {
-			outArea(_area_file);
+		if (_with_area) {
+			if (_surface_area) {
+				writeShell(frame);
+			} else if (!_binary_area) {
+				outArea(_area_file, frame.cells);
+			} else {
+				outTrajectoryFrame(frame.cells);
+			}
 		}
 
-		if (_config.count("with-specs") > 0 && _config.find("with-specs")->second) {
-			outSpecs(_specs_file);
+		if (_with_specs) {
+			outSpecs(_specs_file, frame.cells);
 		}
+
+		if (_height_map) {
+			const VariantSites& sites = frame.shell_sites;
+			outText(_height_file, renderer().heightMap(sites.empty() ? 0 : &sites[0], sites.size()));
+		}
+
+		if (_morphology) {
+			writeMorphology(frame);
+		}
+	}
+}
+
+void Outputer::writeMorphology(const StepFrame& frame) {
+	// строка числа столбцов каждой высоты и строка заполненности каждого слоя, с нулевого до max_z
+	unsigned int layer_size = _ca->sizes().y * _ca->sizes().x;
+	std::string time = frame.info.substr(0, frame.info.find('\t'));
+
+	_morphology_file << time << "\theights";
+	for (unsigned int z = 0; z < frame.heights_nums.size(); ++z) _morphology_file << '\t' << frame.heights_nums[z];
+	outEndl(_morphology_file);
+
+	_morphology_file << time << "\tfill";
+	for (unsigned int z = 0; z < frame.layers_carbons.size(); ++z) {
+		_morphology_file << '\t' << (double)frame.layers_carbons[z] / layer_size;
 	}
+	outEndl(_morphology_file);
+}
+
+void Outputer::writeShell(const StepFrame& frame) {
+	const VariantSites& sites = frame.shell_sites;
+	const std::vector<Cell>& cells = frame.shell_cells;
+	if (!_binary_area) {
+		outText(_area_file, renderer().types(sites.empty() ? 0 : &sites[0], cells.empty() ? 0 : &cells[0], sites.size()));
+		return;
+	}
+
+	// в траектории узлы вне оболочки считаются пустыми
+	_area_types.assign(_ca->lattice().volume(), 0);
+	for (unsigned int i = 0; i < sites.size(); ++i) _area_types[sites[i]] = cells[i].type();
+	trajectory().writeFrame(_area_types);
 }
 
 void Outputer::outputConfigInfo(const Handbook& hb) const {
@@ -85,7 +234,7 @@ void Outputer::outputConfigInfo(const Handbook& hb) const {
 	const double ccc_angle = 109.28; // градусов
 	const double level_width = cc_bond_length * cos(rad * ccc_angle * 0.5);
 
-	const Cell info_cell(_cg->initialSpec(), 0, 0, 0);
+	const Cell info_cell(_cg->initialSpec());
 
 	oci << "Используется конфигурационный файл: " << _cg->configFileName() << "\n"
 			<< "Префикс выходных файлов: " << _cg->prefix() << "\n"
@@ -107,6 +256,15 @@ void Outputer::outputConfigInfo(const Handbook& hb) const {
 			<< "Скорость миграции водорода: " << hb.kMolecule("migrate_H") << " 1/сек\n"
 			<< "Скорость отделения метил-радикала: " << hb.kMolecule("add_CH3") << " 1/сек\n"
 			<< "Процент разрываемых димеров: " << hb.percentOfNotDimers() * 100 << "%\n"
+			<< "Зерно генератора случайных чисел: " << _cg->seed() << "\n"
+			<< "Число потоков расчёта: " << _cg->threads() << "\n";
+	if (_cg->restartFileName() != "") oci << "Расчёт продолжен со снимка: " << _cg->restartFileName() << "\n";
+	if (_cg->checkpointFileName() != "") {
+		oci << "Снимок состояния сохраняется в файл: " << _cg->checkpointFileName();
+		if (_cg->checkpointTime() > 0) oci << " (каждые " << _cg->checkpointTime() << " сек)";
+		oci << "\n";
+	}
+	oci
 			<< "\n"
 			<< "Образование/разрыв димеров " << (_cg->automataConfig()["dimers-form-drop"] ? "включёно" : "отключёно") << "\n"
 			<< "Миграция водорода " << (_cg->automataConfig()["hydrogen-migration"] ? "включёна" : "отключёна") << "\n"
@@ -115,22 +273,32 @@ void Outputer::outputConfigInfo(const Handbook& hb) const {
 			<< "Адсорбция метила " << (_cg->automataConfig()["methyl-adsorption"] ? "включёна" : "отключёна") << "\n"
 			<< "Миграция мостовой группы " << (_cg->automataConfig()["bridge-migration"] ? "включёна" : "отключёна") << "\n"
 			<< "Миграция мостовой группы вверх-вниз " << (_cg->automataConfig()["bridge-migration-up-down"] ? "включёна" : "отключёна") << "\n"
+			<< "Расчёт " << (_cg->automataConfig()["kinetic"] ? "кинетическим Монте-Карло" : "с постоянным шагом по времени") << "\n"
 			<< "\n";
 
 	oci << "Файл для визуализации ";
-	if (_config.count("without-area") == 0 || _config.find("without-area")->second) oci << "не ";
-	oci << "сохраняется\n";
+	if (!_with_area) oci << "не ";
+	oci << "сохраняется";
+	if (_with_area && _binary_area) oci << " в виде двоичной траектории";
+	oci << "\n";
+
+	if (_with_area && _surface_area) oci << "Для визуализации сохраняется только поверхностная оболочка\n";
+	if (_height_map) oci << "Карта высот сохраняется\n";
+	if (_morphology) oci << "Рельеф поверхности отслеживается\n";
+	if (_async_output) oci << "Вывод выполняется в фоновом потоке\n";
 
 	oci << "Инфо ";
-	if (_config.count("without-info") == 0 || _config.find("without-info")->second) oci << "не ";
+	if (!_with_info) oci << "не ";
 	oci << "сохраняется\n";
 
 	oci << "Содержащиеся виды ";
-	if (!(_config.count("with-specs") > 0 && _config.find("with-specs")->second)) oci << "не ";
+	if (!_with_specs) oci << "не ";
 	oci << "сохраняются в текстовом виде\n";
 }
 
 void Outputer::outputCalcTime() const {
+	if (_writer) _writer->flush();
+
 	std::ostream &oct = std::cout;
 	oct << "\nРассчётное время: " << formatTime(time(0) - _start_time) << std::endl;
 }
@@ -10,18 +10,27 @@
 
 #include <ctime>
 #include <fstream>
+#include <iostream>
 #include <string>
+#include <vector>
 
+#include "area_renderer.h"
+#include "async_writer.h"
 #include "automata.h"
 #include "configurator.h"
 #include "flags_config.h"
+#include "info_sink.h"
+#include "trajectory.h"
 
 namespace DiamondCA {
 
 class Outputer {
 public:
-	Outputer(const Configurator& cg);
-	virtual ~Outputer() { }
+	// при -oi и -os результаты выводятся в console вместо выходных файлов
+	Outputer(const Configurator& cg, std::ostream& console = std::cout);
+	// вывод только инфо и только в приёмник sink, без выходных файлов и без заголовка
+	Outputer(const Configurator& cg, InfoSink& sink);
+	virtual ~Outputer();
 
 	void setAutomata(const Automata* ca) { _ca = ca; }
 
@@ -35,42 +44,114 @@ private:
 	Outputer() { }
 
 	inline void outEndl(std::ostream& os) {
-		if (_config.count("clear-output-buffers") > 0 && _config.find("clear-output-buffers")->second) {
+		if (_clear_output_buffers) {
 			os << std::endl;
 		} else {
 			os << '\n';
 		}
 	}
 	inline void outInfoHead(std::ostream& os) {
-		os << _ca->infoHead();
+		os << Automata::infoHead(_morphology);
 		outEndl(os);
 	}
-	inline void outInfoBody(std::ostream& os) {
-		os << _ca->infoBody();
+	inline void outInfoBody(std::ostream& os, const std::string& info) {
+		os << info;
 		outEndl(os);
 	}
-	inline void outArea(std::ostream& os) {
-		os << _ca->typesArea();
-		outEndl(os);
+	inline void outArea(std::ostream& os, const Cell* cells) {
+		outText(os, renderer().types(cells));
+	}
+	inline void outTrajectoryFrame(const Cell* cells) {
+		Automata::areaTypes(_ca->lattice().volume(), cells, _area_types);
+		trajectory().writeFrame(_area_types);
 	}
-	inline void outSpecs(std::ostream& os) {
-		os << _ca->specsArea();
+	inline void outSpecs(std::ostream& os, const Cell* cells) {
+		outText(os, renderer().specs(cells));
+	}
+	inline void outText(std::ostream& os, const std::string& text) {
+		os.write(text.data(), text.size());
 		outEndl(os);
 	}
 
+	// копия состояния на момент вывода; при синхронном выводе решётка не копируется, а копия
+	// - такая же отложенно отображаемая решётка: пустые и общие погребённые страницы память не занимают
+	struct StepFrame {
+		StepFrame() : cells(0), lattice_copy(0) { }
+
+		std::string info;
+		const Cell* cells;
+		Lattice* lattice_copy;
+		VariantSites shell_sites;
+		std::vector<Cell> shell_cells;
+		std::vector<int> heights_nums;
+		std::vector<int> layers_carbons;
+	};
+
+	void takeStep(StepFrame& frame, bool is_copy);
+	void writeStep(const StepFrame& frame);
+	void writeShell(const StepFrame& frame);
+	void writeMorphology(const StepFrame& frame);
+
+	bool needCells() const {
+		return _only_specs || (!_only_info && ((_with_area && !_surface_area) || _with_specs));
+	}
+	bool needShell() const {
+		return !_only_info && !_only_specs && ((_with_area && _surface_area) || _height_map);
+	}
+	bool needMorphology() const {
+		return !_only_info && !_only_specs && _morphology;
+	}
+
+	// создаются при первом выводе, когда известны размеры решётки
+	AreaRenderer& renderer();
+	TrajectoryWriter& trajectory();
+
 	static std::string formatTime(float secs);
 	static std::string humanName(float value, const char* one, const char* few, const char* many);
 
 private:
-	FlagsConfig _config;
+	// параметры вывода, разрешённые из конфигурации при создании
+	bool _only_info;
+	bool _only_specs;
+	bool _clear_output_buffers;
+	bool _with_info;
+	bool _with_area;
+	bool _binary_area;
+	bool _async_output;
+	bool _surface_area;
+	bool _height_map;
+	bool _morphology;
+	bool _with_specs;
 
 	const Automata* _ca;
 	const Configurator* _cg;
+	std::ostream* _console;
+	InfoSink* _info_sink;
 
 	std::ofstream _percent_file;
 	std::ofstream _info_file;
 	std::ofstream _area_file;
 	std::ofstream _specs_file;
+	std::ofstream _height_file;
+	std::ofstream _morphology_file;
+
+	// при двоичном выводе узлы решётки пишутся в траекторию, а не в _area_file
+	std::string _trajectory_file_name;
+	TrajectoryWriter* _trajectory;
+	AreaTypes _area_types;
+
+	// слои решётки форматируются параллельно в собственных потоках вывода: при выводе в фоне
+	// потоки расчёта заняты
+	ThreadPool* _render_pool;
+	AreaRenderer* _renderer;
+
+	// кадров столько же, сколько мест в очереди: кадр заполняется только после того,
+	// как освободилось место, а значит, и записан кадр, занимавший его раньше
+	AsyncWriter* _writer;
+	std::vector<StepFrame> _frames;
+	unsigned int _frames_num;
+	// кадр синхронного вывода
+	StepFrame _frame;
 
 	time_t _start_time;
 };
@@ -0,0 +1,54 @@
+/*
+ * profiler.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <fstream>
+
+#include "profiler.h"
+
+namespace DiamondCA {
+
+static const char* SECTION_NAMES[Profiler::SECTIONS_NUM] = {
+	"hydrogen-migration",
+	"activate-surface",
+	"deactivate-surface",
+	"methyl-adsorption",
+	"bridge-migration",
+	"dimers-forming",
+	"dimers-dropping",
+	"kinetic-events",
+	"output"
+};
+
+const char* Profiler::sectionName(Section section) {
+	return SECTION_NAMES[section];
+}
+
+void Profiler::setReport(const std::string& file_name, unsigned int write_every) {
+	_file_name = file_name;
+	_write_every = write_every;
+}
+
+void Profiler::outputDone() {
+	++_outputs_num;
+	if (_write_every > 0 && _outputs_num % _write_every == 0) writeReport();
+}
+
+void Profiler::writeReport() const {
+	if (_file_name.empty()) return;
+
+	// отчёт каждый раз переписывается целиком, чтобы его можно было читать во время расчёта
+	std::ofstream report(_file_name.c_str());
+	report << "Section\tCalls\tTime (ns)\tCandidates\tEvents\n";
+	for (int s = 0; s < SECTIONS_NUM; ++s) {
+		const Record& record = _records[s];
+		report << sectionName((Section)s) << '\t' << record.calls_num << '\t' << record.time_ns
+				<< '\t' << record.candidates_num << '\t' << record.events_num << '\n';
+	}
+	report << "Outputs\t" << _outputs_num << '\n';
+}
+
+}
@@ -0,0 +1,129 @@
+/*
+ * profiler.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+
+namespace DiamondCA {
+
+// Накопление времени, числа вызовов, кандидатов и событий по процессам расчёта и выводу.
+// Замеры расставляются макросами PROFILE_*, которые раскрываются в пустоту, если программа
+// собрана без PROFILING (make PROFILE=1 включает замеры).
+class Profiler {
+public:
+	enum Section {
+		HYDROGEN_MIGRATION,
+		SURFACE_ACTIVATION,
+		SURFACE_DEACTIVATION,
+		METHYL_ADSORPTION,
+		BRIDGE_MIGRATION,
+		DIMERS_FORMING,
+		DIMERS_DROPPING,
+		KINETIC_EVENTS,
+		OUTPUT,
+		SECTIONS_NUM
+	};
+
+	// замер от создания до уничтожения; base - значение, от которого считаются события
+	class Scope {
+	public:
+		Scope(Profiler& profiler, Section section, uint64_t candidates_num, uint64_t base = 0) :
+				_profiler(&profiler), _section(section), _base(base),
+				_start(std::chrono::steady_clock::now())
+		{
+			Record& record = _profiler->_records[_section];
+			++record.calls_num;
+			record.candidates_num += candidates_num;
+		}
+		~Scope() {
+			_profiler->_records[_section].time_ns +=
+					std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+		}
+
+		uint64_t base() const { return _base; }
+		void addEvents(uint64_t events_num) { _profiler->_records[_section].events_num += events_num; }
+
+	private:
+		Scope();
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+
+	private:
+		Profiler* _profiler;
+		Section _section;
+		uint64_t _base;
+		std::chrono::steady_clock::time_point _start;
+	};
+
+	static bool isCompiled() {
+#ifdef PROFILING
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	Profiler() : _outputs_num(0), _write_every(0) { }
+	virtual ~Profiler() { }
+
+	// отчёт пишется в file_name в конце расчёта и, если write_every > 0, через каждые write_every выводов
+	void setReport(const std::string& file_name, unsigned int write_every);
+
+	void outputDone();
+	void writeReport() const;
+
+	static const char* sectionName(Section section);
+	uint64_t callsNum(Section section) const { return _records[section].calls_num; }
+	uint64_t timeNs(Section section) const { return _records[section].time_ns; }
+	uint64_t candidatesNum(Section section) const { return _records[section].candidates_num; }
+	uint64_t eventsNum(Section section) const { return _records[section].events_num; }
+
+private:
+	struct Record {
+		Record() : calls_num(0), time_ns(0), candidates_num(0), events_num(0) { }
+
+		uint64_t calls_num;
+		uint64_t time_ns;
+		uint64_t candidates_num;
+		uint64_t events_num;
+	};
+
+	Profiler(const Profiler&);
+	Profiler& operator=(const Profiler&);
+
+private:
+	Record _records[SECTIONS_NUM];
+	unsigned int _outputs_num;
+
+	std::string _file_name;
+	unsigned int _write_every;
+};
+
+#ifdef PROFILING
+#define PROFILE_SCOPE(profiler, section, candidates_num) \
+	Profiler::Scope profile_scope(profiler, Profiler::section, candidates_num)
+#define PROFILE_SCOPE_FROM(profiler, section, candidates_num, base) \
+	Profiler::Scope profile_scope(profiler, Profiler::section, candidates_num, base)
+#define PROFILE_BASE profile_scope.base()
+#define PROFILE_EVENTS(events_num) profile_scope.addEvents(events_num)
+#define PROFILE_OUTPUT_DONE(profiler) (profiler).outputDone()
+#define PROFILE_REPORT(profiler) (profiler).writeReport()
+#else
+#define PROFILE_SCOPE(profiler, section, candidates_num)
+#define PROFILE_SCOPE_FROM(profiler, section, candidates_num, base)
+#define PROFILE_EVENTS(events_num)
+#define PROFILE_OUTPUT_DONE(profiler)
+#define PROFILE_REPORT(profiler)
+#endif
+
+}
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,95 @@
+/*
+ * random.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "random.h"
+
+namespace DiamondCA {
+
+Random::Random(uint64_t seed, uint32_t stream) : _index(4) {
+	_key[0] = (uint32_t)seed;
+	_key[1] = (uint32_t)(seed >> 32);
+	_counter[0] = 0;
+	_counter[1] = 0;
+	_counter[2] = stream;
+	_counter[3] = 0;
+}
+
+void Random::fill(uint32_t* values, unsigned int n) {
+	unsigned int i = 0;
+	while (i < n && _index < 4) values[i++] = _block[_index++];
+
+	// целые блоки копируются сразу, без поштучной выдачи
+	for ( ; i + 4 <= n; i += 4) {
+		generate();
+		values[i] = _block[0];
+		values[i + 1] = _block[1];
+		values[i + 2] = _block[2];
+		values[i + 3] = _block[3];
+	}
+	_index = 4;
+
+	while (i < n) values[i++] = next();
+}
+
+void Random::fill(uint32_t bound, uint32_t* values, unsigned int n) {
+	fill(values, n);
+	uint32_t threshold = -bound % bound;
+	for (unsigned int i = 0; i < n; ++i) {
+		uint64_t m = (uint64_t)values[i] * bound;
+		while ((uint32_t)m < threshold) m = (uint64_t)next() * bound;
+		values[i] = m >> 32;
+	}
+}
+
+void Random::state(uint32_t state[8]) const {
+	state[0] = _key[0];
+	state[1] = _key[1];
+	for (int i = 0; i < 4; ++i) state[2 + i] = _counter[i];
+	state[6] = _index;
+	state[7] = 0;
+}
+
+void Random::restore(const uint32_t state[8]) {
+	_key[0] = state[0];
+	_key[1] = state[1];
+	for (int i = 0; i < 4; ++i) _counter[i] = state[2 + i];
+
+	// текущий блок пересчитывается из счётчика, указывающего уже на следующий блок
+	_index = state[6];
+	if (_index < 4) {
+		if (_counter[0]-- == 0) _counter[1]--;
+		generate();
+		_index = state[6];
+	}
+}
+
+void Random::generate() {
+	const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+	const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+	uint32_t c[4] = { _counter[0], _counter[1], _counter[2], _counter[3] };
+	uint32_t k0 = _key[0], k1 = _key[1];
+	for (int round = 0; round < 10; ++round) {
+		uint64_t p0 = (uint64_t)M0 * c[0];
+		uint64_t p1 = (uint64_t)M1 * c[2];
+		uint32_t n0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k0;
+		uint32_t n2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k1;
+		c[1] = (uint32_t)p1;
+		c[3] = (uint32_t)p0;
+		c[0] = n0;
+		c[2] = n2;
+		k0 += W0;
+		k1 += W1;
+	}
+
+	for (int i = 0; i < 4; ++i) _block[i] = c[i];
+	_index = 0;
+
+	if (++_counter[0] == 0) ++_counter[1];
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+ * random.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <stdint.h>
+
+namespace DiamondCA {
+
+// Счётчиковый генератор Philox4x32-10: очередной блок из четырёх 32-битных чисел - это
+// криптографически перемешанный номер блока. Зерно служит ключом, номер потока - старшей частью
+// счётчика, поэтому потоки с разными номерами не пересекаются и не зависят друг от друга.
+class Random {
+public:
+	Random(uint64_t seed = 0, uint32_t stream = 0);
+	virtual ~Random() { }
+
+	uint64_t seed() const { return ((uint64_t)_key[1] << 32) | _key[0]; }
+	uint32_t streamId() const { return _counter[2]; }
+	Random stream(uint32_t stream) const { return Random(seed(), stream); }
+
+	uint32_t next() {
+		if (_index == 4) generate();
+		return _block[_index++];
+	}
+
+	// равномерно распределённое число из (0, 1)
+	double uniform() {
+		uint64_t high = next() >> 5;
+		uint64_t bits = (high << 26) | (next() >> 6);
+		return (bits + 0.5) / 9007199254740992.0;
+	}
+
+	// равномерно распределённое целое из [0, bound), без смещения (метод Лемира)
+	uint32_t bounded(uint32_t bound) {
+		uint64_t m = (uint64_t)next() * bound;
+		if ((uint32_t)m < bound) {
+			uint32_t threshold = -bound % bound;
+			while ((uint32_t)m < threshold) m = (uint64_t)next() * bound;
+		}
+		return m >> 32;
+	}
+
+	void fill(uint32_t* values, unsigned int n);
+	void fill(uint32_t bound, uint32_t* values, unsigned int n);
+
+	// состояние генератора, достаточное для продолжения последовательности
+	void state(uint32_t state[8]) const;
+	void restore(const uint32_t state[8]);
+
+private:
+	void generate();
+
+private:
+	uint32_t _key[2];
+	uint32_t _counter[4];
+	uint32_t _block[4];
+	int _index;
+};
+
+}
+
+#endif /* RANDOM_H_ */
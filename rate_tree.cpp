@@ -0,0 +1,80 @@
+/*
+ * rate_tree.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "rate_tree.h"
+
+namespace DiamondCA {
+
+RateTree::RateTree(unsigned int leaves_num) : _top_capacity(1) {
+	unsigned int pages_num = (leaves_num + PAGE_SIZE - 1) >> PAGE_BITS;
+	while (_top_capacity < pages_num) _top_capacity <<= 1;
+	_top.assign(2 * _top_capacity, 0);
+	_pages.assign(pages_num, 0);
+}
+
+RateTree::~RateTree() {
+	for (unsigned int i = 0; i < _pages.size(); ++i) delete[] _pages[i];
+}
+
+void RateTree::setRate(unsigned int leaf, double rate) {
+	unsigned int page_index = leaf >> PAGE_BITS;
+	double* page = _pages[page_index];
+	if (!page) {
+		if (rate == 0) return;
+		page = _pages[page_index] = new double[2 * PAGE_SIZE]();
+	}
+
+	unsigned int node = PAGE_SIZE + (leaf & (PAGE_SIZE - 1));
+	if (page[node] == rate) return;
+
+	page[node] = rate;
+	for (node >>= 1; node > 0; node >>= 1) {
+		page[node] = page[2 * node] + page[2 * node + 1];
+	}
+
+	// скорости неотрицательны, поэтому нулевая сумма значит, что все листья страницы нулевые
+	double page_total = page[1];
+	if (page_total == 0) {
+		delete[] page;
+		_pages[page_index] = 0;
+	}
+
+	node = _top_capacity + page_index;
+	_top[node] = page_total;
+	for (node >>= 1; node > 0; node >>= 1) {
+		_top[node] = _top[2 * node] + _top[2 * node + 1];
+	}
+}
+
+unsigned int RateTree::find(double& value) const {
+	unsigned int page_index = descend(&_top[0], _top_capacity, value);
+	const double* page = (page_index < _pages.size()) ? _pages[page_index] : 0;
+	if (!page) {
+		// сюда приводит только нулевая общая сумма
+		value = 0;
+		return page_index << PAGE_BITS;
+	}
+	return (page_index << PAGE_BITS) + descend(page, PAGE_SIZE, value);
+}
+
+unsigned int RateTree::descend(const double* nodes, unsigned int leaves_num, double& value) {
+	unsigned int node = 1;
+	while (node < leaves_num) {
+		unsigned int left = 2 * node;
+		if (value < nodes[left] || nodes[left + 1] == 0) {
+			node = left;
+		} else {
+			value -= nodes[left];
+			node = left + 1;
+		}
+	}
+
+	if (value > nodes[node]) value = nodes[node];
+	return node - leaves_num;
+}
+
+}
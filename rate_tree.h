@@ -0,0 +1,55 @@
+/*
+ * rate_tree.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef RATE_TREE_H_
+#define RATE_TREE_H_
+
+#include <vector>
+
+namespace DiamondCA {
+
+// Двоичное дерево сумм скоростей: листья - скорости по узлам, каждый внутренний узел - сумма детей.
+// Изменение скорости и выбор листа пропорционально скорости выполняются за O(log n).
+// Нижние уровни дерева хранятся страницами по PAGE_SIZE листьев, которые выделяются, только пока
+// среди их листьев есть ненулевые, поэтому память расходуется лишь около поверхности.
+// Страницы - поддеревья одного общего дерева, так что суммы не зависят от разбиения на страницы.
+class RateTree {
+public:
+	RateTree(unsigned int leaves_num);
+	virtual ~RateTree();
+
+	double total() const { return _top[1]; }
+	double rate(unsigned int leaf) const {
+		const double* page = _pages[leaf >> PAGE_BITS];
+		return (page) ? page[PAGE_SIZE + (leaf & (PAGE_SIZE - 1))] : 0;
+	}
+
+	void setRate(unsigned int leaf, double rate);
+
+	// находит лист, на который приходится значение value из [0, total()),
+	// в value возвращается остаток внутри найденного листа
+	unsigned int find(double& value) const;
+
+private:
+	enum { PAGE_BITS = 12, PAGE_SIZE = 1 << PAGE_BITS };
+
+	RateTree();
+	RateTree(const RateTree&);
+	RateTree& operator=(const RateTree&);
+
+	static unsigned int descend(const double* nodes, unsigned int leaves_num, double& value);
+
+private:
+	// верхнее дерево, листья которого - суммы страниц
+	unsigned int _top_capacity;
+	std::vector<double> _top;
+	std::vector<double*> _pages;
+};
+
+}
+
+#endif /* RATE_TREE_H_ */
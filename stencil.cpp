@@ -0,0 +1,53 @@
+/*
+ * stencil.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "stencil.h"
+
+namespace DiamondCA {
+
+// в чётных слоях прямые соседи лежат вдоль Y, в нечётных - вдоль X
+const Stencil::Offset Stencil::DIRECT[4][2] = {
+	{ { 0, -1, 0 }, { 0, 1, 0 } },
+	{ { 0, 0, -1 }, { 0, 0, 1 } },
+	{ { 0, -1, 0 }, { 0, 1, 0 } },
+	{ { 0, 0, -1 }, { 0, 0, 1 } }
+};
+
+const Stencil::Offset Stencil::FLAT[4][2][2] = {
+	{ { { 0, -1, 0 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { 0, 0, 1 } } },
+	{ { { 0, 0, -1 }, { 0, 0, 1 } }, { { 0, -1, 0 }, { 0, 1, 0 } } },
+	{ { { 0, -1, 0 }, { 0, 1, 0 } }, { { 0, 0, -1 }, { 0, 0, 1 } } },
+	{ { { 0, 0, -1 }, { 0, 0, 1 } }, { { 0, -1, 0 }, { 0, 1, 0 } } }
+};
+
+const Stencil::Offset Stencil::BOTTOM[4][2] = {
+	{ { -1, 0, -1 }, { -1, 0, 0 } },
+	{ { -1, 0, 0 }, { -1, 1, 0 } },
+	{ { -1, 0, 0 }, { -1, 0, 1 } },
+	{ { -1, -1, 0 }, { -1, 0, 0 } }
+};
+
+const Stencil::Offset Stencil::ABOVE[4][2] = {
+	{ { 1, 0, 0 }, { 1, -1, 0 } },
+	{ { 1, 0, 0 }, { 1, 0, -1 } },
+	{ { 1, 1, 0 }, { 1, 0, 0 } },
+	{ { 1, 0, 1 }, { 1, 0, 0 } }
+};
+
+const Stencil::Offset Stencil::TOP[4] = {
+	{ 1, 0, 0 },
+	{ 1, 0, 0 },
+	{ 1, 1, 0 },
+	{ 1, 0, 1 }
+};
+
+Stencil::Stencil(const int3& sizes) : _wrap_x(sizes.x + 2), _wrap_y(sizes.y + 2) {
+	for (int x = -1; x <= sizes.x; ++x) _wrap_x[x + 1] = (x + sizes.x) % sizes.x;
+	for (int y = -1; y <= sizes.y; ++y) _wrap_y[y + 1] = (y + sizes.y) % sizes.y;
+}
+
+}
@@ -0,0 +1,86 @@
+/*
+ * stencil.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef STENCIL_H_
+#define STENCIL_H_
+
+#include <vector>
+
+#include "int3.h"
+
+namespace DiamondCA {
+
+// Соседи узла в решётке алмаза. Расположение соседей зависит только от класса слоя z % 4,
+// поэтому смещения заранее сведены в таблицы, а замыкание тора по X и Y выполняется
+// поиском в таблице уже замкнутых координат, без ветвлений.
+class Stencil {
+public:
+	Stencil(const int3& sizes);
+	virtual ~Stencil() { }
+
+	// прямые соседи в слое: [0] - меньший, [1] - больший
+	int3 direct(const int3& coords, int i) const { return shift(coords, DIRECT[layer(coords)][i]); }
+	void direct(const int3& coords, int3 neighbours[2]) const {
+		const Offset* offsets = DIRECT[layer(coords)];
+		for (int i = 0; i < 2; ++i) neighbours[i] = shift(coords, offsets[i]);
+	}
+
+	// соседи в слое: [0] - прямые, [1] - поперечные
+	void flat(const int3& coords, int3 neighbours[2][2]) const {
+		const Offset (*offsets)[2] = FLAT[layer(coords)];
+		for (int i = 0; i < 2; ++i) {
+			for (int j = 0; j < 2; ++j) neighbours[i][j] = shift(coords, offsets[i][j]);
+		}
+	}
+
+	// нижние соседи, с которыми узел связан
+	void bottom(const int3& coords, int3 neighbours[2]) const {
+		const Offset* offsets = BOTTOM[layer(coords)];
+		for (int i = 0; i < 2; ++i) neighbours[i] = shift(coords, offsets[i]);
+	}
+
+	// узлы слоя выше, для которых данный узел - нижний сосед
+	void above(const int3& coords, int3 neighbours[2]) const {
+		const Offset* offsets = ABOVE[layer(coords)];
+		for (int i = 0; i < 2; ++i) neighbours[i] = shift(coords, offsets[i]);
+	}
+
+	// верхний сосед пары прямых соседей, то есть узел, нижние соседи которого - эта пара
+	int3 top(const int3& coords1, const int3& coords2) const {
+		const int3& anchor = (direct(coords1, 1) == coords2) ? coords1 : coords2;
+		return shift(anchor, TOP[layer(anchor)]);
+	}
+
+private:
+	struct Offset {
+		int dz, dy, dx;
+	};
+
+	static const Offset DIRECT[4][2];
+	static const Offset FLAT[4][2][2];
+	static const Offset BOTTOM[4][2];
+	// обратные нижним: смещения от узла к узлам слоя z + 1, лежащим на нём
+	static const Offset ABOVE[4][2];
+	// смещение верхнего соседа пары от её меньшего конца
+	static const Offset TOP[4];
+
+	Stencil();
+
+	static int layer(const int3& coords) { return coords.z & 3; }
+
+	// смещения не превышают единицы, поэтому таблицы покрывают координаты от -1 до размера включительно
+	int3 shift(const int3& coords, const Offset& offset) const {
+		return int3(coords.z + offset.dz, _wrap_y[coords.y + offset.dy + 1], _wrap_x[coords.x + offset.dx + 1]);
+	}
+
+private:
+	std::vector<int> _wrap_x, _wrap_y;
+};
+
+}
+
+#endif /* STENCIL_H_ */
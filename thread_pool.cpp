@@ -0,0 +1,75 @@
+/*
+ * thread_pool.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include "thread_pool.h"
+
+namespace DiamondCA {
+
+ThreadPool::ThreadPool(unsigned int threads_num) :
+		_task(0), _tasks_num(0), _next_task(0), _busy_num(0), _generation(0), _stop(false)
+{
+	for (unsigned int i = 1; i < threads_num; ++i) {
+		_workers.push_back(std::thread(&ThreadPool::work, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_started.notify_all();
+	for (unsigned int i = 0; i < _workers.size(); ++i) _workers[i].join();
+}
+
+void ThreadPool::run(unsigned int tasks_num, const PoolTask& task) {
+	if (tasks_num == 0) return;
+	if (_workers.empty() || tasks_num == 1) {
+		for (unsigned int i = 0; i < tasks_num; ++i) task(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_task = &task;
+		_tasks_num = tasks_num;
+		_next_task = 0;
+		_busy_num = _workers.size();
+		++_generation;
+	}
+	_started.notify_all();
+
+	take();
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (_busy_num > 0) _finished.wait(lock);
+	_task = 0;
+}
+
+void ThreadPool::work() {
+	unsigned long generation = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (!_stop && _generation == generation) _started.wait(lock);
+			if (_stop) return;
+			generation = _generation;
+		}
+
+		take();
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (--_busy_num == 0) _finished.notify_one();
+	}
+}
+
+void ThreadPool::take() {
+	unsigned int i;
+	while ((i = _next_task++) < _tasks_num) (*_task)(i);
+}
+
+}
@@ -0,0 +1,57 @@
+/*
+ * thread_pool.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DiamondCA {
+
+typedef std::function<void (unsigned int)> PoolTask;
+
+// Постоянный набор рабочих потоков: run() раздаёт номера заданий свободным потокам
+// (в том числе вызывающему) и возвращает управление, когда выполнены все задания
+class ThreadPool {
+public:
+	ThreadPool(unsigned int threads_num);
+	virtual ~ThreadPool();
+
+	unsigned int size() const { return _workers.size() + 1; }
+
+	void run(unsigned int tasks_num, const PoolTask& task);
+
+private:
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	void work();
+	void take();
+
+private:
+	std::vector<std::thread> _workers;
+
+	std::mutex _mutex;
+	std::condition_variable _started;
+	std::condition_variable _finished;
+
+	const PoolTask* _task;
+	unsigned int _tasks_num;
+	std::atomic<unsigned int> _next_task;
+	unsigned int _busy_num;
+	unsigned long _generation;
+	bool _stop;
+};
+
+}
+
+#endif /* THREAD_POOL_H_ */
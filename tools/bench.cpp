@@ -0,0 +1,251 @@
+/*
+ * bench.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+// Замеры процессов автомата на типовых решётках. Собирается через make bench (с PROFILING):
+// каждый процесс шага замеряется тем же профилировщиком, что и в основной программе.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../automata.h"
+#include "../configurator.h"
+#include "../handbook.h"
+#include "../outputer.h"
+#include "../parse_config_error.h"
+
+#define BENCH_STEPS 1000
+#define BENCH_RENDERS 10
+#define BENCH_Z 64
+
+namespace DiamondCA {
+
+class AutomataBench {
+public:
+	enum Surface {
+		FLAT_SURFACE,
+		DIMERS_SURFACE,
+		ROUGH_SURFACE,
+		SURFACES_NUM
+	};
+
+	AutomataBench(const Handbook& handbook, const Configurator& cg, std::ostream& json) :
+			_handbook(&handbook), _cg(&cg), _json(&json), _is_first(true) { }
+	virtual ~AutomataBench() { }
+
+	void run(Surface surface, int size, unsigned int steps_num, uint64_t seed, unsigned int threads_num);
+
+	void begin() { *_json << "[\n"; }
+	void end() { *_json << "\n]" << std::endl; }
+
+private:
+	AutomataBench();
+	AutomataBench(const AutomataBench&);
+	AutomataBench& operator=(const AutomataBench&);
+
+	static void build(Automata& ca, Surface surface);
+	static void buildRough(Automata& ca);
+	void record(Surface surface, const int3& sizes, const char* section, uint64_t calls_num, uint64_t time_ns,
+			uint64_t candidates_num, uint64_t events_num);
+
+	static const char* surfaceName(Surface surface);
+
+private:
+	const Handbook* _handbook;
+	const Configurator* _cg;
+	std::ostream* _json;
+	bool _is_first;
+};
+
+const char* AutomataBench::surfaceName(Surface surface) {
+	static const char* names[SURFACES_NUM] = { "flat", "dimers", "rough" };
+	return names[surface];
+}
+
+void AutomataBench::build(Automata& ca, Surface surface) {
+	const int3& sizes = ca.sizes();
+	switch (surface) {
+	case FLAT_SURFACE:
+		ca.stickToCells("*H", Range(1, 1));
+		break;
+	case DIMERS_SURFACE:
+		// половина поверхности активна и сразу реконструируется в димеры
+		ca.stickToCells("*H", Range(1, 1));
+		ca.stickToCells("**", Range(1, 1), Range(0, sizes.y / 2 - 1));
+		ca.nextEpoch();
+		ca.formingDimers();
+		break;
+	case ROUGH_SURFACE:
+		buildRough(ca);
+		break;
+	default:
+		break;
+	}
+}
+
+void AutomataBench::buildRough(Automata& ca) {
+	// холмы высотой до 9 слоёв, соседние столбцы отличаются не больше чем на слой,
+	// так что у каждого узла есть оба нижних соседа
+	const int3& sizes = ca.sizes();
+	int period_x = (sizes.x % 16 == 0) ? 16 : sizes.x;
+	int period_y = (sizes.y % 16 == 0) ? 16 : sizes.y;
+	int max_z = 0;
+	for (int y = 0; y < sizes.y; ++y) {
+		for (int x = 0; x < sizes.x; ++x) {
+			int tx = std::min(x % period_x, period_x - x % period_x) / 2;
+			int ty = std::min(y % period_y, period_y - y % period_y) / 2;
+			int height = std::min(1 + tx + ty, sizes.z - 2);
+			ca.stickToCells("", Range(1, height), Range(y, y), Range(x, x));
+			max_z = std::max(max_z, height);
+		}
+	}
+
+	// свободные связи - только к пустым верхним соседям: вершины покрыты "*H", края террас - водородом
+	static const char* mixes[3] = { "", "H", "*H" };
+	for (int z = 1; z <= max_z; ++z) {
+		for (int y = 0; y < sizes.y; ++y) {
+			for (int x = 0; x < sizes.x; ++x) {
+				int3 coords(z, y, x);
+				if (ca._lattice[ca._lattice.site(coords)].empty()) continue;
+
+				int3 above_coords[2];
+				ca._stencil.above(coords, above_coords);
+				int free_bonds_num = 0;
+				for (int i = 0; i < 2; ++i) {
+					if (ca._lattice[ca._lattice.site(above_coords[i])].empty()) ++free_bonds_num;
+				}
+				if (free_bonds_num > 0) ca.stickToCells(mixes[free_bonds_num], Range(z, z), Range(y, y), Range(x, x));
+			}
+		}
+	}
+}
+
+void AutomataBench::run(Surface surface, int size, unsigned int steps_num, uint64_t seed,
+		unsigned int threads_num)
+{
+	Handbook handbook = *_handbook;
+	handbook.setSizes(int3(BENCH_Z, size, size));
+
+	Outputer outputer(*_cg);
+	Automata ca(handbook, _cg->automataConfig(), outputer);
+	ca.seed(seed);
+	ca.setThreads(threads_num);
+	build(ca, surface);
+
+	const int3& sizes = ca.sizes();
+	std::cerr << surfaceName(surface) << ' ' << sizes.x << 'x' << sizes.y << 'x' << sizes.z << std::endl;
+
+	for (unsigned int i = 0; i < steps_num; ++i) ca.step();
+
+	for (int s = 0; s < Profiler::OUTPUT; ++s) {
+		Profiler::Section section = (Profiler::Section)s;
+		if (ca._profiler.callsNum(section) == 0) continue;
+		record(surface, sizes, Profiler::sectionName(section), ca._profiler.callsNum(section),
+				ca._profiler.timeNs(section), ca._profiler.candidatesNum(section), ca._profiler.eventsNum(section));
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	size_t length = 0;
+	Clock::time_point start = Clock::now();
+	for (int i = 0; i < BENCH_RENDERS; ++i) length += ca.typesArea().size();
+	uint64_t time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	record(surface, sizes, "types-area", BENCH_RENDERS, time_ns, 0, 0);
+
+	start = Clock::now();
+	for (int i = 0; i < BENCH_RENDERS; ++i) length += ca.specsArea().size();
+	time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	record(surface, sizes, "specs-area", BENCH_RENDERS, time_ns, 0, 0);
+
+	// иначе форматирование могло бы быть выброшено оптимизатором
+	if (length == 0) std::cerr << "Empty area" << std::endl;
+}
+
+void AutomataBench::record(Surface surface, const int3& sizes, const char* section, uint64_t calls_num,
+		uint64_t time_ns, uint64_t candidates_num, uint64_t events_num)
+{
+	double secs = time_ns * 1e-9;
+	double sites_num = (double)sizes.x * sizes.y * sizes.z;
+
+	if (!_is_first) *_json << ",\n";
+	_is_first = false;
+
+	*_json << "  {\"lattice\": \"" << surfaceName(surface) << "\", "
+			<< "\"x\": " << sizes.x << ", \"y\": " << sizes.y << ", \"z\": " << sizes.z << ", "
+			<< "\"section\": \"" << section << "\", "
+			<< "\"calls\": " << calls_num << ", \"time_ns\": " << time_ns << ", "
+			<< "\"candidates\": " << candidates_num << ", \"events\": " << events_num << ", "
+			<< "\"events_per_sec\": " << ((secs > 0) ? events_num / secs : 0) << ", "
+			<< "\"ns_per_site\": " << ((calls_num > 0) ? time_ns / (calls_num * sites_num) : 0) << "}";
+}
+
+}
+
+using namespace DiamondCA;
+
+int main(int argc, char* argv[]) {
+	std::string config_file_name = CONFIG_FILE;
+	std::string json_file_name = "bench.json";
+	unsigned int steps_num = BENCH_STEPS;
+	unsigned int threads_num = 1;
+	uint64_t seed = 1;
+	std::vector<int> sizes;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* param = argv[i];
+		if (strncmp(param, "-c=", 3) == 0) config_file_name = param + 3;
+		else if (strncmp(param, "-o=", 3) == 0) json_file_name = param + 3;
+		else if (strncmp(param, "-st=", 4) == 0) steps_num = atoi(param + 4);
+		else if (strncmp(param, "-th=", 4) == 0) threads_num = atoi(param + 4);
+		else if (strncmp(param, "-sd=", 4) == 0) seed = strtoull(param + 4, 0, 10);
+		else if (strncmp(param, "-s=", 3) == 0) sizes.push_back(atoi(param + 3));
+		else {
+			std::cerr << "Usage: " << argv[0] << " [-c=handbook.cnf] [-o=bench.json] [-st=steps] "
+					<< "[-th=threads] [-sd=seed] [-s=size ...]" << std::endl;
+			return 1;
+		}
+	}
+	if (sizes.empty()) {
+		sizes.push_back(32);
+		sizes.push_back(64);
+		sizes.push_back(128);
+	}
+	if (threads_num == 0) threads_num = 1;
+
+	Handbook handbook;
+	try {
+		handbook.parseConfig(config_file_name);
+	} catch(const ParseConfigError& e) {
+		std::cerr << "Configuration file (" << config_file_name << ") contains error: "
+				<< e.getMessage() << std::endl;
+		return 1;
+	}
+
+	// выходные файлы автомата не нужны
+	char program_name[] = "bench";
+	char only_info[] = "-oi";
+	char* params[] = { program_name, only_info };
+	Configurator configurator;
+	configurator.parseParams(2, params);
+
+	std::ofstream json(json_file_name.c_str());
+	AutomataBench bench(handbook, configurator, json);
+	bench.begin();
+	for (unsigned int i = 0; i < sizes.size(); ++i) {
+		for (int s = 0; s < AutomataBench::SURFACES_NUM; ++s) {
+			bench.run((AutomataBench::Surface)s, sizes[i], steps_num, seed, threads_num);
+		}
+	}
+	bench.end();
+
+	return 0;
+}
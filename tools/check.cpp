@@ -0,0 +1,349 @@
+/*
+ * check.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+// Детерминированные проверки отдельных частей автомата. Собирается и запускается через make check
+// (там же варианты расчёта сравниваются программой validate). Каждая проверка выводит ok или FAIL
+// с описанием расхождения, код возврата ненулевой, если не прошла хотя бы одна.
+
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../automata.h"
+#include "../checkpoint_error.h"
+#include "../configurator.h"
+#include "../handbook.h"
+#include "../indexed_set.h"
+#include "../outputer.h"
+#include "../random.h"
+#include "../rate_tree.h"
+
+// конфигурация и решётка расчётов для проверки снимков
+#define CHECK_CONFIG "-c=tools/check.cnf"
+#define CHECK_CHECKPOINT "check-checkpoint.bin"
+// допустимое отклонение частот от ожидаемых в стандартных отклонениях
+#define FREQUENCY_Z_LIMIT 5.0
+
+namespace DiamondCA {
+
+class Checker {
+public:
+	Checker() : _failures_num(0) { }
+	virtual ~Checker() { }
+
+	void expect(bool condition, const std::string& what) {
+		if (condition) return;
+		std::cout << "FAIL " << _name << ": " << what << std::endl;
+		++_failures_num;
+	}
+
+	void begin(const std::string& name) {
+		_name = name;
+		_name_failures_num = _failures_num;
+	}
+	void end() {
+		if (_failures_num == _name_failures_num) std::cout << "ok " << _name << std::endl;
+	}
+
+	unsigned int failuresNum() const { return _failures_num; }
+
+private:
+	Checker(const Checker&);
+	Checker& operator=(const Checker&);
+
+private:
+	std::string _name;
+	unsigned int _failures_num;
+	unsigned int _name_failures_num;
+};
+
+// частота count из n при вероятности p не дальше FREQUENCY_Z_LIMIT стандартных отклонений
+static bool isExpectedFrequency(unsigned int count, unsigned int n, double p) {
+	double deviation = std::sqrt(n * p * (1 - p));
+	return std::fabs(count - n * p) <= FREQUENCY_Z_LIMIT * deviation;
+}
+
+static void checkIndexedSet(Checker& checker) {
+	checker.begin("IndexedSet swap-remove");
+
+	// узлы из разных страниц индекса
+	const SiteId sites[] = { 7, 4096 * 3 + 1, 0, 100000, 4095 };
+	const unsigned int sites_num = sizeof(sites) / sizeof(sites[0]);
+	IndexedSet set;
+	for (unsigned int i = 0; i < sites_num; ++i) checker.expect(set.insert(sites[i]), "insert of a new site");
+	checker.expect(!set.insert(sites[2]), "repeated insert returns false");
+	checker.expect(set.size() == sites_num, "size after inserts");
+	for (unsigned int i = 0; i < sites_num; ++i) {
+		checker.expect(set.indexOf(sites[i]) == i && set[i] == sites[i], "insertion order");
+	}
+	checker.expect(!set.contains(8) && set.indexOf(8) == IndexedSet::NO_INDEX, "absent site");
+
+	// на место удалённого встаёт последний элемент
+	checker.expect(set.erase(sites[1]), "erase of a member");
+	checker.expect(!set.contains(sites[1]), "erased site is not a member");
+	checker.expect(set.size() == sites_num - 1, "size after erase");
+	checker.expect(set[1] == sites[4] && set.indexOf(sites[4]) == 1, "last member moved into the hole");
+	checker.expect(set[3] == sites[3] && set.indexOf(sites[3]) == 3, "other members keep their places");
+	checker.expect(!set.erase(sites[1]), "repeated erase returns false");
+
+	// удаление последнего элемента ничего не переставляет
+	checker.expect(set.erase(sites[3]) && set.size() == 3 && set[2] == sites[2], "erase of the last member");
+	for (unsigned int i = 0; i < set.size(); ++i) checker.expect(set.indexOf(set[i]) == i, "index of every member");
+
+	set.clear();
+	checker.expect(set.empty() && !set.contains(sites[0]), "clear");
+	checker.expect(set.insert(sites[0]) && set.indexOf(sites[0]) == 0, "insert after clear");
+
+	checker.end();
+}
+
+static void checkRateTree(Checker& checker) {
+	checker.begin("RateTree sampling");
+
+	// листья в нескольких страницах, последняя неполная
+	const unsigned int leaves_num = 3 * 4096 + 10;
+	const unsigned int leaves[] = { 0, 5, 4096, 2 * 4096 + 17, leaves_num - 1 };
+	const double rates[] = { 1, 2, 0.5, 4, 2.5 };
+	const unsigned int rates_num = sizeof(rates) / sizeof(rates[0]);
+	RateTree tree(leaves_num);
+	checker.expect(tree.total() == 0, "empty tree");
+	double total = 0;
+	for (unsigned int i = 0; i < rates_num; ++i) {
+		tree.setRate(leaves[i], rates[i]);
+		total += rates[i];
+	}
+	checker.expect(tree.total() == total, "total is the sum of rates");
+	checker.expect(tree.rate(leaves[3]) == rates[3] && tree.rate(1) == 0, "rates of leaves");
+
+	// значения внутри каждого листа и на его границах
+	double begin = 0;
+	for (unsigned int i = 0; i < rates_num; ++i) {
+		double value = begin;
+		checker.expect(tree.find(value) == leaves[i] && value == 0, "begin of a leaf");
+		value = begin + rates[i] / 2;
+		checker.expect(tree.find(value) == leaves[i] && value == rates[i] / 2, "middle of a leaf");
+		begin += rates[i];
+	}
+
+	// частоты выбора пропорциональны скоростям
+	const unsigned int samples_num = 200000;
+	Random random(1);
+	std::vector<unsigned int> counts(rates_num, 0);
+	for (unsigned int s = 0; s < samples_num; ++s) {
+		double value = random.uniform() * tree.total();
+		unsigned int leaf = tree.find(value);
+		for (unsigned int i = 0; i < rates_num; ++i) {
+			if (leaf == leaves[i]) ++counts[i];
+		}
+	}
+	unsigned int counted_num = 0;
+	for (unsigned int i = 0; i < rates_num; ++i) {
+		checker.expect(isExpectedFrequency(counts[i], samples_num, rates[i] / total), "frequency of a leaf");
+		counted_num += counts[i];
+	}
+	checker.expect(counted_num == samples_num, "only leaves with rates are found");
+
+	// обнулённый лист больше не выбирается
+	tree.setRate(leaves[3], 0);
+	checker.expect(tree.total() == total - rates[3], "total after zeroing");
+	for (unsigned int s = 0; s < 10000; ++s) {
+		double value = random.uniform() * tree.total();
+		if (tree.find(value) == leaves[3]) {
+			checker.expect(false, "zeroed leaf is found");
+			break;
+		}
+	}
+	for (unsigned int i = 0; i < rates_num; ++i) tree.setRate(leaves[i], 0);
+	checker.expect(tree.total() == 0, "total after zeroing all leaves");
+
+	checker.end();
+}
+
+// очередной блок генератора с ключом key и счётчиком counter
+static void philoxBlock(const uint32_t key[2], const uint32_t counter[4], uint32_t block[4]) {
+	uint32_t state[8] = { key[0], key[1], counter[0], counter[1], counter[2], counter[3], 4, 0 };
+	Random random;
+	random.restore(state);
+	for (int i = 0; i < 4; ++i) block[i] = random.next();
+}
+
+static void checkRandom(Checker& checker) {
+	checker.begin("Philox4x32-10 and Lemire");
+
+	// известные ответы Philox4x32-10 (Random123): ключ, счётчик, блок
+	const uint32_t answers[][10] = {
+		{ 0, 0, 0, 0, 0, 0, 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+		{ 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+				0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+		{ 0xa4093822, 0x299f31d0, 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
+				0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+	};
+	for (unsigned int a = 0; a < sizeof(answers) / sizeof(answers[0]); ++a) {
+		uint32_t block[4];
+		philoxBlock(answers[a], answers[a] + 2, block);
+		for (int i = 0; i < 4; ++i) checker.expect(block[i] == answers[a][6 + i], "known answer block");
+	}
+
+	// зерно - ключ, поток - третье слово счётчика
+	Random random(0xa4093822299f31d0ull, 7);
+	uint32_t key[2] = { 0x299f31d0, 0xa4093822 }, counter[4] = { 1, 0, 7, 0 }, block[4];
+	philoxBlock(key, counter, block);
+	for (int i = 0; i < 4; ++i) random.next();
+	for (int i = 0; i < 4; ++i) checker.expect(random.next() == block[i], "second block of a stream");
+
+	// продолжение последовательности после сохранения состояния и заполнение массивов
+	Random original(42, 3);
+	for (int i = 0; i < 5; ++i) original.next();
+	uint32_t state[8];
+	original.state(state);
+	Random restored, filled;
+	restored.restore(state);
+	filled.restore(state);
+	uint32_t values[11];
+	filled.fill(values, 11);
+	for (int i = 0; i < 11; ++i) {
+		uint32_t value = original.next();
+		checker.expect(restored.next() == value && values[i] == value, "restored and filled sequences");
+	}
+
+	// Лемир без смещения: при границе 3 * 2^30 остаток от деления удвоил бы частоту первой трети
+	const uint32_t bound = 0xc0000000;
+	const unsigned int samples_num = 300000;
+	unsigned int counts[3] = { 0, 0, 0 };
+	bool is_bounded = true;
+	for (unsigned int s = 0; s < samples_num; ++s) {
+		uint32_t value = random.bounded(bound);
+		is_bounded = is_bounded && value < bound;
+		if (value < bound) ++counts[value >> 30];
+	}
+	checker.expect(is_bounded, "bounded values are less than the bound");
+	for (int i = 0; i < 3; ++i) {
+		checker.expect(isExpectedFrequency(counts[i], samples_num, 1.0 / 3), "uniform thirds of the bound");
+	}
+
+	uint32_t small[1000];
+	random.fill(6, small, 1000);
+	unsigned int faces[6] = { 0, 0, 0, 0, 0, 0 };
+	bool is_small = true;
+	for (int i = 0; i < 1000; ++i) {
+		is_small = is_small && small[i] < 6;
+		if (small[i] < 6) ++faces[small[i]];
+	}
+	checker.expect(is_small, "filled values are less than the bound");
+	for (int i = 0; i < 6; ++i) checker.expect(isExpectedFrequency(faces[i], 1000, 1.0 / 6), "uniform faces");
+	checker.expect(random.bounded(1) == 0, "single value");
+
+	checker.end();
+}
+
+// Расчёт с параметрами params идёт до save_time и затем продолжается до конца: кинетический расчёт
+// отбрасывает ожидание, вышедшее за save_time, поэтому и непрерывный расчёт прерывается там же.
+// Расчёт SAVING_RUN после save_time сохраняет снимок и останавливается, RESTORED_RUN - продолжается
+// с сохранённого снимка
+enum RunMode { SPLIT_RUN, SAVING_RUN, RESTORED_RUN };
+
+static std::string runAutomata(const std::string& params, float save_time, RunMode mode) {
+	std::vector<std::string> words;
+	words.push_back("check");
+	std::istringstream params_stream(std::string(CHECK_CONFIG) + " -oi -sd=3 " + params);
+	std::string word;
+	while (params_stream >> word) words.push_back(word);
+	std::vector<char*> argv;
+	for (unsigned int i = 0; i < words.size(); ++i) argv.push_back(&words[i][0]);
+	Configurator configurator;
+	configurator.parseParams(argv.size(), &argv[0]);
+
+	Handbook handbook;
+	handbook.parseConfig(configurator.configFileName());
+	handbook.setSizes(configurator.sizes());
+
+	std::stringstream info;
+	Outputer outputer(configurator, info);
+	Automata ca(handbook, configurator.automataConfig(), outputer);
+	ca.seed(configurator.seed());
+	ca.setThreads(configurator.threads());
+	if (mode == RESTORED_RUN) {
+		ca.restore(CHECK_CHECKPOINT);
+	} else {
+		ca.stickInitialCells(configurator.initialSpec());
+		ca.run(save_time, configurator.anyTime());
+	}
+
+	if (mode == SAVING_RUN) {
+		ca.setCheckpoint(CHECK_CHECKPOINT, 0);
+		// снимок по сигналу сохраняется после следующего шага (события), и расчёт останавливается
+		raise(SIGTERM);
+	}
+	ca.run(configurator.fullTime(), configurator.anyTime());
+	return info.str();
+}
+
+// строки инфо без заголовка
+static void infoRows(const std::string& info, std::vector<std::string>& rows) {
+	std::istringstream is(info);
+	std::string line;
+	std::getline(is, line);
+	rows.clear();
+	while (std::getline(is, line)) {
+		if (!line.empty()) rows.push_back(line);
+	}
+}
+
+static void checkCheckpoint(Checker& checker, const std::string& params) {
+	checker.begin("checkpoint round-trip (" + params + ")");
+
+	try {
+		std::vector<std::string> whole_rows, saved_rows, restored_rows;
+		infoRows(runAutomata(params, 0.05, SPLIT_RUN), whole_rows);
+		infoRows(runAutomata(params, 0.05, SAVING_RUN), saved_rows);
+		infoRows(runAutomata(params, 0.05, RESTORED_RUN), restored_rows);
+
+		// продолжение совпадает с концом непрерывного расчёта
+		checker.expect(!restored_rows.empty() && restored_rows.size() < whole_rows.size(),
+				"restored run outputs a part of the rows");
+		checker.expect(saved_rows.size() + restored_rows.size() >= whole_rows.size(), "rows are not lost");
+		unsigned int shift = whole_rows.size() - restored_rows.size();
+		for (unsigned int i = 0; i < restored_rows.size() && i + shift < whole_rows.size(); ++i) {
+			if (restored_rows[i] != whole_rows[i + shift]) {
+				checker.expect(false, "restored row differs: " + restored_rows[i] + " vs " + whole_rows[i + shift]);
+				break;
+			}
+		}
+		for (unsigned int i = 0; i < saved_rows.size() && i < whole_rows.size(); ++i) {
+			if (saved_rows[i] != whole_rows[i]) {
+				checker.expect(false, "row before the checkpoint differs");
+				break;
+			}
+		}
+	} catch(const CheckpointError& e) {
+		checker.expect(false, e.getMessage());
+	}
+	remove(CHECK_CHECKPOINT);
+
+	checker.end();
+}
+
+}
+
+using namespace DiamondCA;
+
+int main() {
+	Checker checker;
+	checkIndexedSet(checker);
+	checkRateTree(checker);
+	checkRandom(checker);
+	checkCheckpoint(checker, "-x=16 -y=16 -z=30 -ft=0.1 -at=0.005");
+	checkCheckpoint(checker, "-x=16 -y=16 -z=30 -ft=0.1 -at=0.005 -th=2");
+	checkCheckpoint(checker, "-x=16 -y=16 -z=30 -ft=0.1 -at=0.005 -kmc");
+
+	std::cout << ((checker.failuresNum() == 0) ? "PASS" : "FAIL") << std::endl;
+	return (checker.failuresNum() == 0) ? 0 : 1;
+}
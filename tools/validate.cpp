@@ -0,0 +1,322 @@
+/*
+ * validate.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+// Статистическая проверка равноценности двух вариантов расчёта. Собирается через make validate.
+// Оба варианта запускаются с одними и теми же зёрнами, сравниваются ряды инфо по всем колонкам:
+// средние и разброс в каждый момент вывода, а также распределения итоговых значений (критерий
+// Колмогорова-Смирнова). Порядок розыгрыша случайных чисел в вариантах может отличаться,
+// поэтому побайтовое сравнение выходных файлов здесь не годится.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../automata.h"
+#include "../configurator.h"
+#include "../handbook.h"
+#include "../outputer.h"
+#include "../parse_config_error.h"
+#include "../parse_error.h"
+#include "../parse_params_error.h"
+
+#define VALIDATE_SEEDS 20
+// допустимая разность средних значений и средних отклонений от медианы в стандартных ошибках
+#define Z_LIMIT 4.0
+// коэффициент критического значения критерия Колмогорова-Смирнова для уровня 0.001
+#define KS_COEFFICIENT 1.95
+
+namespace DiamondCA {
+
+// ряды инфо одного расчёта: строка на каждый вывод, колонки - как в файле инфо
+struct InfoSeries {
+	std::vector<std::string> columns;
+	std::vector<std::vector<double> > rows;
+};
+
+class EngineVariant {
+public:
+	EngineVariant(const std::string& name, const std::string& params);
+	virtual ~EngineVariant() { }
+
+	const std::string& name() const { return _name; }
+	const std::string& params() const { return _params; }
+	double secs() const { return _secs; }
+
+	// отсчёт эпох автомата начинается с first_epoch (0 - как обычно), например у самого
+	// переполнения счётчика: кэш назначений мостовых групп не должен влиять на результат
+	void setFirstEpoch(uint64_t first_epoch) { _first_epoch = first_epoch; }
+
+	void run(uint64_t seed, InfoSeries& series);
+
+private:
+	EngineVariant();
+	EngineVariant(const EngineVariant&);
+	EngineVariant& operator=(const EngineVariant&);
+
+	void parseParams(uint64_t seed, Configurator& configurator) const;
+	static void parseInfo(std::istream& is, InfoSeries& series);
+
+private:
+	std::string _name;
+	std::string _params;
+	double _secs;
+	uint64_t _first_epoch;
+};
+
+EngineVariant::EngineVariant(const std::string& name, const std::string& params) :
+		_name(name), _params(params), _secs(0), _first_epoch(0) { }
+
+void EngineVariant::parseParams(uint64_t seed, Configurator& configurator) const {
+	std::vector<std::string> words;
+	words.push_back("validate");
+	std::istringstream params(_params);
+	std::string word;
+	while (params >> word) words.push_back(word);
+	words.push_back("-oi");
+	std::ostringstream seed_param;
+	seed_param << "-sd=" << seed;
+	words.push_back(seed_param.str());
+
+	std::vector<char*> argv;
+	for (unsigned int i = 0; i < words.size(); ++i) argv.push_back(&words[i][0]);
+	configurator.parseParams(argv.size(), &argv[0]);
+}
+
+void EngineVariant::run(uint64_t seed, InfoSeries& series) {
+	Configurator configurator;
+	parseParams(seed, configurator);
+
+	Handbook handbook;
+	handbook.parseConfig(configurator.configFileName());
+	handbook.setSizes(configurator.sizes());
+
+	std::stringstream info;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		Outputer outputer(configurator, info);
+		Automata ca(handbook, configurator.automataConfig(), outputer);
+		ca.seed(configurator.seed());
+		ca.setThreads(configurator.threads());
+		ca.stickInitialCells(configurator.initialSpec());
+		if (flagOf(configurator.outputerConfig(), "morphology")) ca.trackMorphology();
+		if (_first_epoch > 0) ca.setEpoch(_first_epoch);
+		ca.run(configurator.fullTime(), configurator.anyTime());
+	}
+	_secs += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	parseInfo(info, series);
+}
+
+void EngineVariant::parseInfo(std::istream& is, InfoSeries& series) {
+	std::string line;
+	std::getline(is, line);
+	std::istringstream head(line);
+	std::string column;
+	series.columns.clear();
+	while (std::getline(head, column, '\t')) series.columns.push_back(column);
+
+	series.rows.clear();
+	while (std::getline(is, line)) {
+		if (line.empty()) continue;
+		std::istringstream body(line);
+		std::vector<double> row;
+		double value;
+		while (body >> value) row.push_back(value);
+		series.rows.push_back(row);
+	}
+}
+
+// выборочные среднее и несмещённая дисперсия
+static void meanVariance(const std::vector<double>& values, double& mean, double& variance) {
+	mean = 0;
+	for (unsigned int i = 0; i < values.size(); ++i) mean += values[i];
+	mean /= values.size();
+
+	variance = 0;
+	for (unsigned int i = 0; i < values.size(); ++i) variance += (values[i] - mean) * (values[i] - mean);
+	variance = (values.size() > 1) ? variance / (values.size() - 1) : 0;
+}
+
+// разность средних двух выборок в стандартных ошибках; false, если разброса нет, а средние различны
+static bool meansDifference(const std::vector<double>& a, const std::vector<double>& b, double& z) {
+	double mean_a, variance_a, mean_b, variance_b;
+	meanVariance(a, mean_a, variance_a);
+	meanVariance(b, mean_b, variance_b);
+
+	double error = std::sqrt(variance_a / a.size() + variance_b / b.size());
+	z = (error > 0) ? std::fabs(mean_a - mean_b) / error : 0;
+	return error > 0 || mean_a == mean_b;
+}
+
+// абсолютные отклонения значений от медианы выборки: разброс сравнивается по их средним (критерий
+// Брауна-Форсайта), что, в отличие от отношения дисперсий, не требует нормальности распределения
+static void medianDeviations(const std::vector<double>& values, std::vector<double>& deviations) {
+	std::vector<double> sorted(values);
+	std::sort(sorted.begin(), sorted.end());
+	unsigned int middle = sorted.size() / 2;
+	double median = (sorted.size() % 2 == 1) ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+
+	deviations.resize(values.size());
+	for (unsigned int i = 0; i < values.size(); ++i) deviations[i] = std::fabs(values[i] - median);
+}
+
+// статистика двухвыборочного критерия Колмогорова-Смирнова
+static double ksStatistic(std::vector<double> a, std::vector<double> b) {
+	std::sort(a.begin(), a.end());
+	std::sort(b.begin(), b.end());
+
+	double d = 0;
+	unsigned int i = 0, j = 0;
+	while (i < a.size() && j < b.size()) {
+		double value = std::min(a[i], b[j]);
+		while (i < a.size() && a[i] == value) ++i;
+		while (j < b.size() && b[j] == value) ++j;
+		d = std::max(d, std::fabs((double)i / a.size() - (double)j / b.size()));
+	}
+	return d;
+}
+
+class Validator {
+public:
+	Validator(unsigned int seeds_num) : _seeds_num(seeds_num) { }
+	virtual ~Validator() { }
+
+	// возвращает true, если варианты статистически неразличимы
+	bool compare(EngineVariant& a, EngineVariant& b, uint64_t first_seed, std::ostream& os);
+
+private:
+	Validator();
+	Validator(const Validator&);
+	Validator& operator=(const Validator&);
+
+	// значения колонки в строке row по всем зёрнам
+	static void samples(const std::vector<InfoSeries>& runs, unsigned int row, unsigned int column,
+			std::vector<double>& values);
+
+private:
+	unsigned int _seeds_num;
+};
+
+void Validator::samples(const std::vector<InfoSeries>& runs, unsigned int row, unsigned int column,
+		std::vector<double>& values)
+{
+	values.clear();
+	for (unsigned int r = 0; r < runs.size(); ++r) values.push_back(runs[r].rows[row][column]);
+}
+
+bool Validator::compare(EngineVariant& a, EngineVariant& b, uint64_t first_seed, std::ostream& os) {
+	std::vector<InfoSeries> runs_a(_seeds_num), runs_b(_seeds_num);
+	for (unsigned int i = 0; i < _seeds_num; ++i) {
+		std::cerr << "seed " << first_seed + i << std::endl;
+		a.run(first_seed + i, runs_a[i]);
+		b.run(first_seed + i, runs_b[i]);
+	}
+
+	const InfoSeries& sample = runs_a[0];
+	for (unsigned int i = 0; i < _seeds_num; ++i) {
+		if (runs_a[i].columns != sample.columns || runs_b[i].columns != sample.columns
+				|| runs_a[i].rows.size() != sample.rows.size() || runs_b[i].rows.size() != sample.rows.size())
+		{
+			os << "Variants output different info columns or numbers of outputs" << std::endl;
+			return false;
+		}
+	}
+
+	double ks_critical = KS_COEFFICIENT * std::sqrt(2.0 / _seeds_num);
+	unsigned int last_row = sample.rows.size() - 1;
+
+	os << "Column\tMax mean z\tMax spread z\tFinal KS D\tKS critical\tResult\n";
+	bool is_equivalent = true;
+	std::vector<double> values_a, values_b, deviations_a, deviations_b;
+	// первая колонка - время вывода, одинаковое у обоих вариантов
+	for (unsigned int c = 1; c < sample.columns.size(); ++c) {
+		double max_mean_z = 0, max_spread_z = 0;
+		bool is_column_equivalent = true;
+		for (unsigned int r = 0; r <= last_row; ++r) {
+			samples(runs_a, r, c, values_a);
+			samples(runs_b, r, c, values_b);
+
+			double z;
+			if (!meansDifference(values_a, values_b, z)) is_column_equivalent = false;
+			max_mean_z = std::max(max_mean_z, z);
+
+			medianDeviations(values_a, deviations_a);
+			medianDeviations(values_b, deviations_b);
+			if (!meansDifference(deviations_a, deviations_b, z)) is_column_equivalent = false;
+			max_spread_z = std::max(max_spread_z, z);
+		}
+
+		samples(runs_a, last_row, c, values_a);
+		samples(runs_b, last_row, c, values_b);
+		double ks = ksStatistic(values_a, values_b);
+
+		if (max_mean_z > Z_LIMIT || max_spread_z > Z_LIMIT || ks > ks_critical) is_column_equivalent = false;
+		is_equivalent = is_equivalent && is_column_equivalent;
+
+		os << sample.columns[c] << '\t' << max_mean_z << '\t' << max_spread_z << '\t' << ks << '\t'
+				<< ks_critical << '\t' << (is_column_equivalent ? "pass" : "FAIL") << '\n';
+	}
+
+	os << '\n' << a.name() << " (" << a.params() << "): " << a.secs() << " s\n"
+			<< b.name() << " (" << b.params() << "): " << b.secs() << " s\n"
+			<< "Speedup of " << b.name() << ": " << ((b.secs() > 0) ? a.secs() / b.secs() : 0) << '\n'
+			<< (is_equivalent ? "PASS" : "FAIL") << std::endl;
+	return is_equivalent;
+}
+
+}
+
+using namespace DiamondCA;
+
+int main(int argc, char* argv[]) {
+	std::string params_a, params_b;
+	unsigned int seeds_num = VALIDATE_SEEDS;
+	uint64_t first_seed = 1;
+	uint64_t first_epoch_b = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		const char* param = argv[i];
+		if (strncmp(param, "-a=", 3) == 0) params_a = param + 3;
+		else if (strncmp(param, "-b=", 3) == 0) params_b = param + 3;
+		else if (strncmp(param, "-n=", 3) == 0) seeds_num = atoi(param + 3);
+		else if (strncmp(param, "-sd=", 4) == 0) first_seed = strtoull(param + 4, 0, 10);
+		else if (strncmp(param, "-eb=", 4) == 0) first_epoch_b = strtoull(param + 4, 0, 10);
+		else {
+			std::cerr << "Usage: " << argv[0] << " -a=\"parameters of variant A\" -b=\"parameters of variant B\" "
+					<< "[-n=seeds] [-sd=first_seed] [-eb=first_epoch_of_B]\n"
+					<< "Parameters are those of diamond_easy (-c, -x, -y, -z, -ft, -at, -th, -kmc, -wo-...); "
+					<< "-oi and -sd are added for every run.\n"
+					<< "-eb starts the epoch counter of B near its overflow, e.g. -eb=18446744073709551000 "
+					<< "with -b equal to -a must give identical results" << std::endl;
+			return 1;
+		}
+	}
+	if (seeds_num < 2) {
+		std::cerr << "At least two seeds (-n) are needed" << std::endl;
+		return 1;
+	}
+
+	EngineVariant a("A", params_a), b("B", params_b);
+	b.setFirstEpoch(first_epoch_b);
+	Validator validator(seeds_num);
+	try {
+		return validator.compare(a, b, first_seed, std::cout) ? 0 : 1;
+	} catch(const ParseParamsError& e) {
+		std::cerr << e.getMessage() << std::endl;
+	} catch(const ParseConfigError& e) {
+		std::cerr << "Configuration file contains error: " << e.getMessage() << std::endl;
+	} catch(const ParseError& e) {
+		std::cerr << e.getMessage() << std::endl;
+	}
+	return 2;
+}
@@ -0,0 +1,214 @@
+/*
+ * trajectory.cpp
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#include <cstring>
+
+#include "area_renderer.h"
+#include "trajectory.h"
+#include "trajectory_error.h"
+
+namespace DiamondCA {
+
+static const char TRAJECTORY_MAGIC[8] = { 'D', 'C', 'A', 'T', 'R', 'J', '1', '\0' };
+static const char INDEX_MAGIC[8] = { 'D', 'C', 'A', 'T', 'I', 'D', 'X', '\0' };
+
+enum FrameKind {
+	DELTA_FRAME,
+	KEY_FRAME
+};
+
+static void appendVarint(std::vector<unsigned char>& bytes, uint64_t value) {
+	while (value >= 0x80) {
+		bytes.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((unsigned char)value);
+}
+
+// индекс в конце файла: смещение и вид каждого кадра, затем число кадров, смещение индекса и метка
+static const unsigned int INDEX_TAIL_SIZE = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(INDEX_MAGIC);
+
+TrajectoryWriter::TrajectoryWriter(const std::string& file_name, const int3& sizes) :
+		_file(file_name.c_str(), std::ios::binary),
+		_previous((unsigned int)sizes.x * sizes.y * sizes.z, 0)
+{
+	int32_t header_sizes[3] = { sizes.x, sizes.y, sizes.z };
+	_file.write(TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+	_file.write((const char*)header_sizes, sizeof(header_sizes));
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+	uint64_t index_offset = _file.tellp();
+	for (unsigned int i = 0; i < _offsets.size(); ++i) {
+		unsigned char kind = (i % KEYFRAME_PERIOD == 0) ? KEY_FRAME : DELTA_FRAME;
+		_file.write((const char*)&_offsets[i], sizeof(uint64_t));
+		_file.write((const char*)&kind, 1);
+	}
+	uint32_t frames_num = _offsets.size();
+	_file.write((const char*)&frames_num, sizeof(frames_num));
+	_file.write((const char*)&index_offset, sizeof(index_offset));
+	_file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+}
+
+void TrajectoryWriter::writeFrame(const AreaTypes& types) {
+	bool is_key = (_offsets.size() % KEYFRAME_PERIOD == 0);
+	_offsets.push_back(_file.tellp());
+
+	// ключевой кадр - это разность с пустой решёткой
+	if (is_key) _previous.assign(_previous.size(), 0);
+
+	_changes.clear();
+	uint64_t changes_num = 0;
+	int64_t last_site = -1;
+	for (unsigned int site = 0; site < types.size(); ++site) {
+		if (types[site] == _previous[site]) continue;
+
+		appendVarint(_changes, site - last_site - 1);
+		_changes.push_back(types[site]);
+		_previous[site] = types[site];
+		last_site = site;
+		++changes_num;
+	}
+
+	_head.clear();
+	_head.push_back(is_key ? KEY_FRAME : DELTA_FRAME);
+	appendVarint(_head, changes_num);
+	_file.write((const char*)&_head[0], _head.size());
+	if (!_changes.empty()) _file.write((const char*)&_changes[0], _changes.size());
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& file_name) :
+		_file(file_name.c_str(), std::ios::binary), _next_frame(0)
+{
+	if (!_file) throw TrajectoryError("Cannot open trajectory file " + file_name);
+
+	char magic[sizeof(TRAJECTORY_MAGIC)];
+	int32_t header_sizes[3];
+	_file.read(magic, sizeof(magic));
+	_file.read((char*)header_sizes, sizeof(header_sizes));
+	if (!_file || memcmp(magic, TRAJECTORY_MAGIC, sizeof(magic)) != 0) {
+		throw TrajectoryError("File " + file_name + " is not an area trajectory");
+	}
+	_sizes = int3(header_sizes[2], header_sizes[1], header_sizes[0]);
+	_volume = (unsigned int)_sizes.x * _sizes.y * _sizes.z;
+
+	// у прерванной записи индекса нет, тогда кадры находятся последовательным просмотром
+	if (!readIndex()) scanFrames();
+}
+
+bool TrajectoryReader::readIndex() {
+	uint64_t header_size = sizeof(TRAJECTORY_MAGIC) + 3 * sizeof(int32_t);
+	_file.seekg(0, std::ios::end);
+	uint64_t file_size = _file.tellg();
+	if (file_size < header_size + INDEX_TAIL_SIZE) return false;
+
+	char magic[sizeof(INDEX_MAGIC)];
+	uint32_t frames_num;
+	uint64_t index_offset;
+	_file.seekg(file_size - INDEX_TAIL_SIZE);
+	_file.read((char*)&frames_num, sizeof(frames_num));
+	_file.read((char*)&index_offset, sizeof(index_offset));
+	_file.read(magic, sizeof(magic));
+	if (!_file || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) return false;
+
+	_file.seekg(index_offset);
+	_offsets.resize(frames_num);
+	_keyframes.resize(frames_num);
+	for (unsigned int i = 0; i < frames_num; ++i) {
+		unsigned char kind;
+		_file.read((char*)&_offsets[i], sizeof(uint64_t));
+		_file.read((char*)&kind, 1);
+		_keyframes[i] = (kind == KEY_FRAME);
+	}
+	return !_file.fail();
+}
+
+void TrajectoryReader::scanFrames() {
+	_file.clear();
+	_file.seekg(sizeof(TRAJECTORY_MAGIC) + 3 * sizeof(int32_t));
+	_offsets.clear();
+	_keyframes.clear();
+
+	while (true) {
+		uint64_t offset = _file.tellg();
+		int kind = _file.get();
+		if (kind != DELTA_FRAME && kind != KEY_FRAME) break;
+
+		uint64_t changes_num = readVarint();
+		for (uint64_t i = 0; i < changes_num && _file; ++i) {
+			readVarint();
+			_file.get();
+		}
+		// недописанный последний кадр отбрасывается
+		if (!_file) break;
+
+		_offsets.push_back(offset);
+		_keyframes.push_back(kind == KEY_FRAME);
+	}
+	_file.clear();
+}
+
+void TrajectoryReader::readFrame(unsigned int frame, AreaTypes& types) {
+	if (frame >= framesNum()) throw TrajectoryError("Trajectory has no such frame");
+
+	unsigned int key = frame;
+	while (!_keyframes[key]) --key;
+
+	types.assign(_volume, 0);
+	for (unsigned int f = key; f <= frame; ++f) applyFrame(f, types);
+	_next_frame = frame + 1;
+}
+
+bool TrajectoryReader::nextFrame(AreaTypes& types) {
+	if (_next_frame >= framesNum()) return false;
+
+	if (_next_frame == 0 || types.size() != _volume) {
+		readFrame(_next_frame, types);
+	} else {
+		applyFrame(_next_frame++, types);
+	}
+	return true;
+}
+
+void TrajectoryReader::applyFrame(unsigned int frame, AreaTypes& types) {
+	_file.seekg(_offsets[frame]);
+	int kind = _file.get();
+	if (kind == KEY_FRAME) types.assign(_volume, 0);
+
+	uint64_t changes_num = readVarint();
+	uint64_t site = (uint64_t)-1;
+	for (uint64_t i = 0; i < changes_num; ++i) {
+		site += readVarint() + 1;
+		int type = _file.get();
+		if (!_file || site >= _volume) throw TrajectoryError("Trajectory frame is corrupted");
+		types[site] = type;
+	}
+}
+
+uint64_t TrajectoryReader::readVarint() {
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int byte = _file.get();
+		if (byte == EOF) break;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) break;
+	}
+	return value;
+}
+
+void TrajectoryReader::writeText(std::ostream& os) {
+	AreaRenderer renderer(_sizes);
+	AreaTypes types;
+	_next_frame = 0;
+	while (nextFrame(types)) {
+		const std::string& text = renderer.types(&types[0]);
+		os.write(text.data(), text.size());
+		os << '\n';
+	}
+}
+
+}
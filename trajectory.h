@@ -0,0 +1,88 @@
+/*
+ * trajectory.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "int3.h"
+
+namespace DiamondCA {
+
+// типы узлов решётки одного кадра подряд по номерам узлов, 0 - пустой узел
+typedef std::vector<unsigned char> AreaTypes;
+
+// Двоичная траектория типов узлов решётки. После заголовка идут кадры: ключевой кадр содержит
+// все занятые узлы, разностный - только узлы, тип которых изменился с предыдущего кадра.
+// Узлы кадра записываются парами (расстояние от предыдущего записанного узла, новый тип),
+// расстояние - переменной длины (по 7 бит в байте). Ключевой кадр повторяется каждые
+// KEYFRAME_PERIOD кадров, в конце файла - индекс смещений всех кадров для перехода к любому кадру.
+class TrajectoryWriter {
+public:
+	enum { KEYFRAME_PERIOD = 100 };
+
+	TrajectoryWriter(const std::string& file_name, const int3& sizes);
+	// дописывает индекс кадров
+	virtual ~TrajectoryWriter();
+
+	void writeFrame(const AreaTypes& types);
+
+private:
+	TrajectoryWriter();
+	TrajectoryWriter(const TrajectoryWriter&);
+	TrajectoryWriter& operator=(const TrajectoryWriter&);
+
+private:
+	std::ofstream _file;
+	AreaTypes _previous;
+	std::vector<uint64_t> _offsets;
+	std::vector<unsigned char> _head;
+	std::vector<unsigned char> _changes;
+};
+
+class TrajectoryReader {
+public:
+	TrajectoryReader(const std::string& file_name);
+	virtual ~TrajectoryReader() { }
+
+	const int3& sizes() const { return _sizes; }
+	unsigned int framesNum() const { return _offsets.size(); }
+
+	// восстанавливает кадр с номером frame, начиная с ближайшего ключевого кадра перед ним
+	void readFrame(unsigned int frame, AreaTypes& types);
+	// следующий по порядку кадр; false, если кадры закончились
+	bool nextFrame(AreaTypes& types);
+
+	// все кадры подряд в текстовом виде, то есть содержимое файла .wxyz
+	void writeText(std::ostream& os);
+
+private:
+	TrajectoryReader();
+	TrajectoryReader(const TrajectoryReader&);
+	TrajectoryReader& operator=(const TrajectoryReader&);
+
+	bool readIndex();
+	void scanFrames();
+	void applyFrame(unsigned int frame, AreaTypes& types);
+	uint64_t readVarint();
+
+private:
+	std::ifstream _file;
+	int3 _sizes;
+	unsigned int _volume;
+	std::vector<uint64_t> _offsets;
+	std::vector<bool> _keyframes;
+	unsigned int _next_frame;
+};
+
+}
+
+#endif /* TRAJECTORY_H_ */
@@ -0,0 +1,31 @@
+/*
+ * trajectory_error.h
+ *
+ *  Created on: 17.10.2026
+ *      Author: agent
+ */
+
+#ifndef TRAJECTORY_ERROR_H_
+#define TRAJECTORY_ERROR_H_
+
+#include <string>
+
+namespace DiamondCA {
+
+class TrajectoryError {
+public:
+	TrajectoryError(const std::string& message) : _message(message) { }
+	virtual ~TrajectoryError() { }
+
+	virtual std::string getMessage() const { return _message; }
+
+private:
+	TrajectoryError() { }
+
+private:
+	std::string _message;
+};
+
+}
+
+#endif /* TRAJECTORY_ERROR_H_ */